@@ -5,26 +5,32 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../core/comm/comm.c \
-../core/comm/crc.c 
+../core/comm/crc.c \
+../core/comm/comm_usci.c 
 
 OBJS += \
 ./core/comm/comm.obj \
-./core/comm/crc.obj 
+./core/comm/crc.obj \
+./core/comm/comm_usci.obj 
 
 C_DEPS += \
 ./core/comm/comm.pp \
-./core/comm/crc.pp 
+./core/comm/crc.pp \
+./core/comm/comm_usci.pp 
 
 C_DEPS__QUOTED += \
 "core\comm\comm.pp" \
-"core\comm\crc.pp" 
+"core\comm\crc.pp" \
+"core\comm\comm_usci.pp" 
 
 OBJS__QUOTED += \
 "core\comm\comm.obj" \
-"core\comm\crc.obj" 
+"core\comm\crc.obj" \
+"core\comm\comm_usci.obj" 
 
 C_SRCS__QUOTED += \
 "../core/comm/comm.c" \
-"../core/comm/crc.c" 
+"../core/comm/crc.c" \
+"../core/comm/comm_usci.c" 
 
 
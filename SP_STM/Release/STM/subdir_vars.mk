@@ -0,0 +1,30 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+C_SRCS += \
+../STM/STM.c \
+../STM/STM_parse.c 
+
+OBJS += \
+./STM/STM.obj \
+./STM/STM_parse.obj 
+
+C_DEPS += \
+./STM/STM.pp \
+./STM/STM_parse.pp 
+
+C_DEPS__QUOTED += \
+"STM\STM.pp" \
+"STM\STM_parse.pp" 
+
+OBJS__QUOTED += \
+"STM\STM.obj" \
+"STM\STM_parse.obj" 
+
+C_SRCS__QUOTED += \
+"../STM/STM.c" \
+"../STM/STM_parse.c" 
+
+
@@ -0,0 +1,60 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+C_SRCS += \
+../core/core.c \
+../core/flash.c \
+../core/log.c \
+../core/diag.c \
+../core/power.c \
+../core/config.c \
+../core/sched.c 
+
+OBJS += \
+./core/core.obj \
+./core/flash.obj \
+./core/log.obj \
+./core/diag.obj \
+./core/power.obj \
+./core/config.obj \
+./core/sched.obj 
+
+C_DEPS += \
+./core/core.pp \
+./core/flash.pp \
+./core/log.pp \
+./core/diag.pp \
+./core/power.pp \
+./core/config.pp \
+./core/sched.pp 
+
+C_DEPS__QUOTED += \
+"core\core.pp" \
+"core\flash.pp" \
+"core\log.pp" \
+"core\diag.pp" \
+"core\power.pp" \
+"core\config.pp" \
+"core\sched.pp" 
+
+OBJS__QUOTED += \
+"core\core.obj" \
+"core\flash.obj" \
+"core\log.obj" \
+"core\diag.obj" \
+"core\power.obj" \
+"core\config.obj" \
+"core\sched.obj" 
+
+C_SRCS__QUOTED += \
+"../core/core.c" \
+"../core/flash.c" \
+"../core/log.c" \
+"../core/diag.c" \
+"../core/power.c" \
+"../core/config.c" \
+"../core/sched.c" 
+
+
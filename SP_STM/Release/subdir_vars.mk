@@ -0,0 +1,33 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CMD_SRCS += \
+../lnk_msp430f235.cmd 
+
+C_SRCS += \
+../irupt.c \
+../main.c 
+
+OBJS += \
+./irupt.obj \
+./main.obj 
+
+C_DEPS += \
+./irupt.pp \
+./main.pp 
+
+C_DEPS__QUOTED += \
+"irupt.pp" \
+"main.pp" 
+
+OBJS__QUOTED += \
+"irupt.obj" \
+"main.obj" 
+
+C_SRCS__QUOTED += \
+"../irupt.c" \
+"../main.c" 
+
+
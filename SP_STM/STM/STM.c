@@ -16,16 +16,6 @@
 //#include STM.h //Now included in core.h
 #include "../core/core.h"
 
-//! \def MPS6
-//! \brief Decagon's code indicating sensor is MPS6
-#define MPS6	0x6C
-//! \def FIVETM
-//! \brief Decagon's code indicating sensor is  5TM
-#define FIVETM	0x78
-//! \def FIVETE
-//! \brief Decagon's code indicating sensor is  5TE
-#define FIVETE	0x7A
-
 //******************  RX Variables  *****************************************//
 //! @name Receive Variables
 //! These variables are used in the receiving of data on the \ref comm Module.
@@ -49,6 +39,10 @@ char cSTM_RX_Pin;
 //! \var g_ucSTM_RXBusy
 //! \brief Indicates that we are receiving a byte
 uint8 g_ucSTM_RXBusy;
+
+//! \var g_ucSTM_RXChannelIdx
+//! \brief The channel (0 = STM1) the single channel receiver feeds to the parser
+uint8 g_ucSTM_RXChannelIdx;
 //! @}
 
 //******************  Values  *****************************************//
@@ -62,27 +56,105 @@ int16 nSTM_Temperature;
 //! \var int32 ulSTM_Soil
 //! \brief The Soil Moisture Value of STM4.
 int32 lSTM_Soil;
+
+//! \var uiSTM_Spread
+//! \brief The spread of the burst behind lSTM_Soil, see uiSTM_GetSpread()
+uint16 uiSTM_Spread;
 //! @}
 
-//! \var uiSTM1_type
-//! \brief The sensor type for STM1.
-uint8 uiSTM1_type = 0x52;
+//******************  Batch Variables  *****************************************//
+//! @name Batch Acquisition Variables
+//! These variables are shared between vSTM_MeasureBatch() and the batch
+//! sampler in TIMERB1_ISR.
+//! @{
+//! \var g_ucaSTM_ExciteBits
+//! \brief Power pin of each channel, indexed by channel - 1
+const uint8 g_ucaSTM_ExciteBits[NUM_STM_CHANNELS] = { cSTM_1_PWR_PIN, cSTM_2_PWR_PIN, cSTM_3_PWR_PIN, cSTM_4_PWR_PIN };
+
+//! \var g_ucaSTM_RXBits
+//! \brief RX pin of each channel, indexed by channel - 1
+const uint8 g_ucaSTM_RXBits[NUM_STM_CHANNELS] = { cSTM_1_RX_PIN, cSTM_2_RX_PIN, cSTM_3_RX_PIN, cSTM_4_RX_PIN };
+
+//! \var g_saSTM_BatchChannel
+//! \brief Receive state of each channel in the batch sampler
+S_STM_BatchChannel g_saSTM_BatchChannel[NUM_STM_CHANNELS];
+
+//! \var g_ucSTM_BatchActive
+//! \brief Mask of the channels the sampler is still receiving from
+volatile uint8 g_ucSTM_BatchActive;
 
-//! \var uiSTM2_type
-//! \brief The sensor type for STM2.
-uint8 uiSTM2_type = 0x52;
+//! \var g_ucSTM_BatchReady
+//! \brief Mask of the channels holding a batch result not yet taken by cSTM_Measure()
+uint8 g_ucSTM_BatchReady;
 
-//! \var uiSTM3_type
-//! \brief The sensor type for STM3.
-uint8 uiSTM3_type = 0x52;
+//! \var g_caSTM_BatchResult
+//! \brief Result code of each channel from the last batch (same codes as cSTM_Measure())
+char g_caSTM_BatchResult[NUM_STM_CHANNELS];
 
-//! \var uiSTM4_type
-//! \brief The sensor type for STM4.
-uint8 uiSTM4_type = 0x52;
+//! \var g_laSTM_BatchSoil
+//! \brief Soil moisture of each channel from the last batch
+int32 g_laSTM_BatchSoil[NUM_STM_CHANNELS];
+
+//! \var g_naSTM_BatchTemperature
+//! \brief Temperature of each channel from the last batch
+int16 g_naSTM_BatchTemperature[NUM_STM_CHANNELS];
+
+//! \var g_uiaSTM_BatchSpread
+//! \brief Spread of the burst of each channel from the last batch
+uint16 g_uiaSTM_BatchSpread[NUM_STM_CHANNELS];
+//! @}
+
+//******************  Burst Variables  *****************************************//
+//! @name Burst Variables
+//! @{
+//! \var g_ucaSTM_BurstFrames
+//! \brief Frames per measurement of each channel, kept in the config store
+uint8 g_ucaSTM_BurstFrames[NUM_STM_CHANNELS] = { 1, 1, 1, 1 };
+
+//! \var g_saSTM_Burst
+//! \brief The good frames of the burst in progress on each channel
+S_STM_Burst g_saSTM_Burst[NUM_STM_CHANNELS];
+//! @}
 
-//! \var timeoutcounter
-//! \brief Timeout used to exit the measurement process when response takes too long
-char timeoutcounter = 0;
+//! \var g_saSTM_Health
+//! \brief The health of each channel, see ucSTM_FetchHealth()
+S_STM_Health g_saSTM_Health[NUM_STM_CHANNELS];
+
+//! \var g_uiaSTM_Duration
+//! \brief Average measurement time of each channel in ms << STM_DURATION_SHIFT, 0 while not measured
+uint16 g_uiaSTM_Duration[NUM_STM_CHANNELS];
+
+//! \var g_ucaSTM_SensorType
+//! \brief The sensor type of each channel, kept in the config store
+//!
+//! Set by cSTM_RequestSensorType() and by every good frame, which carries the
+//! same type byte.
+uint8 g_ucaSTM_SensorType[NUM_STM_CHANNELS] = { STM_TYPE_UNKNOWN, STM_TYPE_UNKNOWN, STM_TYPE_UNKNOWN, STM_TYPE_UNKNOWN };
+
+//! \var g_ucSTM_TypeGen
+//! \brief Counts the changes of g_ucaSTM_SensorType, see ucSTM_GetTypeGen()
+uint8 g_ucSTM_TypeGen;
+
+//! \var g_uiaSTM_LatencyMs
+//! \brief The learned latency of each timing profile in ms, 0 while not known
+uint16 g_uiaSTM_LatencyMs[STM_NUM_PROFILES];
+
+//! \var g_ucSTM_LatencyMiss
+//! \brief Channels whose last read failed, bit 0 = STM1, they use the full window until a good frame
+uint8 g_ucSTM_LatencyMiss;
+
+//******************  Event Variables  *****************************************//
+//! @name Frame Event Variables
+//! Shared between the read functions and TIMERB1_ISR.
+//! @{
+//! \var g_ucSTM_Event
+//! \brief STM_EVENT_FRAME and STM_EVENT_TIMEOUT flags raised by the ISRs
+volatile uint8 g_ucSTM_Event;
+
+//! \var g_uiSTM_DeadlineMsLeft
+//! \brief Part of the deadline not yet armed on TBCCR2
+uint16 g_uiSTM_DeadlineMsLeft;
+//! @}
 
 //! \var ISR
 //! \var ADCISRindicator
@@ -90,6 +162,476 @@ char timeoutcounter = 0;
 char ISR = 0;
 char ADCISRindicator = 0;
 
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Records the sensor type of a channel
+//!
+//! The config store is only written when the type changes.
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4; ucSensorType, the type byte
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_SetSensorType(uint8 ucChannelIdx, uint8 ucSensorType)
+{
+	uint16 uiaTypes[NUM_STM_CHANNELS / 2];
+	uint8 ucIdx;
+
+	if (g_ucaSTM_SensorType[ucChannelIdx] == ucSensorType)
+		return;
+
+	g_ucaSTM_SensorType[ucChannelIdx] = ucSensorType;
+	g_ucSTM_TypeGen++;
+
+	// Another sensor takes another time
+	g_uiaSTM_Duration[ucChannelIdx] = 0;
+
+	for (ucIdx = 0; ucIdx < NUM_STM_CHANNELS / 2; ucIdx++)
+		uiaTypes[ucIdx] = (uint16) g_ucaSTM_SensorType[2 * ucIdx] | ((uint16) g_ucaSTM_SensorType[2 * ucIdx + 1] << 8);
+
+	ucConfig_Write(CONFIG_KEY_SENSOR_TYPES, uiaTypes, NUM_STM_CHANNELS / 2);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns how long a channel settles before its RX window opens
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+//! \return The time from the excite in ms, at least STM_POWER_UP_MS
+/////////////////////////////////////////////////////////////////////////
+static uint16 uiSTM_GetSettleMs(uint8 ucChannelIdx)
+{
+	uint8 ucProfile;
+
+	ucProfile = ucSTM_GetProfileIdx(g_ucaSTM_SensorType[ucChannelIdx]);
+	if ((ucProfile == STM_NUM_PROFILES) || (g_ucSTM_LatencyMiss & (1 << ucChannelIdx))
+			|| (g_uiaSTM_LatencyMs[ucProfile] < (STM_POWER_UP_MS + STM_RX_GUARD_MS)))
+		return STM_POWER_UP_MS;
+
+	return g_uiaSTM_LatencyMs[ucProfile] - STM_RX_GUARD_MS;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns when the RX window of a channel closes
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+//! \return The time from the excite in ms
+/////////////////////////////////////////////////////////////////////////
+static uint16 uiSTM_GetEndMs(uint8 ucChannelIdx)
+{
+	uint8 ucProfile;
+
+	ucProfile = ucSTM_GetProfileIdx(g_ucaSTM_SensorType[ucChannelIdx]);
+	if ((ucProfile == STM_NUM_PROFILES) || (g_ucSTM_LatencyMiss & (1 << ucChannelIdx)) || (g_uiaSTM_LatencyMs[ucProfile] == 0))
+		return STM_POWER_UP_MS + uiSTM_GetTimeoutMs(g_ucaSTM_SensorType[ucChannelIdx]);
+
+	return g_uiaSTM_LatencyMs[ucProfile] + STM_FRAME_MS + STM_RX_GUARD_MS;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Takes the sensor type and the latency from a finished read
+//!
+//! A good frame refreshes the sensor type and its timing profile.  A failed
+//! read puts only its own channel back on the full window, in case the
+//! learned window missed the frame: the profile is shared by every channel
+//! of the sensor type, so an absent or dead sensor leaves the others and the
+//! stored latency alone.  The config store is only written once the latency
+//! has drifted by more than STM_LATENCY_SLACK_MS.
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4; uiEndMs, when the RX window closed
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_FinishRead(uint8 ucChannelIdx, uint16 uiEndMs)
+{
+	S_STM_Parser *pParser;
+	uint16 uiaStored[STM_NUM_PROFILES];
+	uint16 uiLatencyMs;
+	uint8 ucProfile;
+	uint8 ucIdx;
+
+	pParser = &g_saSTM_Parser[ucChannelIdx];
+
+	if (pParser->m_cResult != 0)
+	{
+		g_ucSTM_LatencyMiss |= 1 << ucChannelIdx;
+		return;
+	}
+
+	// A good frame carries the sensor type too
+	vSTM_SetSensorType(ucChannelIdx, pParser->m_ucSensorType);
+	g_ucSTM_LatencyMiss &= ~(1 << ucChannelIdx);
+
+	ucProfile = ucSTM_GetProfileIdx(g_ucaSTM_SensorType[ucChannelIdx]);
+	if (ucProfile == STM_NUM_PROFILES)
+		return;
+
+	if ((pParser->m_uiEdgeMsLeft == 0) || (pParser->m_uiEdgeMsLeft > uiEndMs))
+		return;
+
+	// Follow slowly so a single late start does not move the window
+	uiLatencyMs = uiEndMs - pParser->m_uiEdgeMsLeft;
+	if (g_uiaSTM_LatencyMs[ucProfile] == 0)
+		g_uiaSTM_LatencyMs[ucProfile] = uiLatencyMs;
+	else
+		g_uiaSTM_LatencyMs[ucProfile] = (3 * g_uiaSTM_LatencyMs[ucProfile] + uiLatencyMs) >> 2;
+
+	for (ucIdx = 0; ucIdx < STM_NUM_PROFILES; ucIdx++)
+		uiaStored[ucIdx] = 0;
+	ucConfig_Read(CONFIG_KEY_STM_LATENCY, uiaStored, STM_NUM_PROFILES);
+
+	if ((g_uiaSTM_LatencyMs[ucProfile] > (uiaStored[ucProfile] + STM_LATENCY_SLACK_MS))
+			|| ((g_uiaSTM_LatencyMs[ucProfile] + STM_LATENCY_SLACK_MS) < uiaStored[ucProfile]))
+	{
+		uiaStored[ucProfile] = g_uiaSTM_LatencyMs[ucProfile];
+		ucConfig_Write(CONFIG_KEY_STM_LATENCY, uiaStored, STM_NUM_PROFILES);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Starts a burst on a channel
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_BurstReset(uint8 ucChannelIdx)
+{
+	g_saSTM_Burst[ucChannelIdx].m_ucGood = 0;
+	g_saSTM_Burst[ucChannelIdx].m_cResult = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Adds the frame the parser finished to the burst of a channel
+//!
+//! The values are inserted in order so the median is the middle entry.  A
+//! failed frame is counted and dropped.
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_BurstAdd(uint8 ucChannelIdx)
+{
+	S_STM_Parser *pParser;
+	S_STM_Burst *pBurst;
+	uint8 ucIdx;
+
+	pParser = &g_saSTM_Parser[ucChannelIdx];
+	pBurst = &g_saSTM_Burst[ucChannelIdx];
+
+	if (pParser->m_cResult)
+	{
+		if (pParser->m_cResult == STM_ERROR_CODE_1) {
+			DIAG_COUNT(DIAG_CNT_STM_CHECKSUM);
+		}
+		else {
+			DIAG_COUNT(DIAG_CNT_STM_TIMEOUT);
+		}
+
+		pBurst->m_cResult = pParser->m_cResult;
+		return;
+	}
+
+	if (pBurst->m_ucGood >= STM_BURST_MAX)
+		return;
+
+	for (ucIdx = pBurst->m_ucGood; (ucIdx > 0) && (pBurst->m_laSoil[ucIdx - 1] > pParser->m_lSoil); ucIdx--)
+		pBurst->m_laSoil[ucIdx] = pBurst->m_laSoil[ucIdx - 1];
+	pBurst->m_laSoil[ucIdx] = pParser->m_lSoil;
+
+	for (ucIdx = pBurst->m_ucGood; (ucIdx > 0) && (pBurst->m_naTemperature[ucIdx - 1] > pParser->m_nTemperature); ucIdx--)
+		pBurst->m_naTemperature[ucIdx] = pBurst->m_naTemperature[ucIdx - 1];
+	pBurst->m_naTemperature[ucIdx] = pParser->m_nTemperature;
+
+	pBurst->m_ucGood++;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Works out the result of the burst on a channel
+//!
+//! The values are left alone if no frame was good.
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4; *plSoil, *pnTemperature and
+//! *puiSpread, where the median and the spread go, see uiSTM_GetSpread()
+//! \return 0, or the code of the last failed frame if none was good
+/////////////////////////////////////////////////////////////////////////
+static char cSTM_BurstResult(uint8 ucChannelIdx, int32 *plSoil, int16 *pnTemperature, uint16 *puiSpread)
+{
+	S_STM_Burst *pBurst;
+	uint32 ulSpread;
+	uint8 ucLast;
+
+	pBurst = &g_saSTM_Burst[ucChannelIdx];
+	if (pBurst->m_ucGood == 0)
+		return pBurst->m_cResult ? pBurst->m_cResult : STM_ERROR_CODE_2;
+
+	// The lower of the two middle entries for an even count
+	ucLast = pBurst->m_ucGood - 1;
+	*plSoil = pBurst->m_laSoil[ucLast >> 1];
+	*pnTemperature = pBurst->m_naTemperature[ucLast >> 1];
+
+	ulSpread = (uint32) (pBurst->m_laSoil[ucLast] - pBurst->m_laSoil[0]);
+
+	*puiSpread = (ulSpread > 0x7FFF) ? 0x7FFF : (uint16) ulSpread;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Leaves the sensors off between the frames of a burst
+//!
+//! \param uiMs, the time off, STM_BURST_REST_MS or the backoff of a retry
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_BurstRest(uint16 uiMs)
+{
+	STM_TIMER_START();
+	vSTM_StartDeadline(uiMs);
+	ucSTM_WaitForEvent();
+	TBCCTL2 &= ~CCIE;
+	STM_TIMER_STOP();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns the channels of a burst that are worth a retry
+//!
+//! A channel is retried when none of its frames were good, unless it has
+//! already failed STM_HEALTH_FAIL_LIMIT measurements in a row.  Every channel
+//! returned is counted as retried.
+//!
+//! \param ucChannelMask, bit 0 = STM1 ... bit 3 = STM4
+//! \return The channels to read again
+/////////////////////////////////////////////////////////////////////////
+static uint8 ucSTM_RetryMask(uint8 ucChannelMask)
+{
+	uint8 ucChannelIdx;
+
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		if (!(ucChannelMask & (1 << ucChannelIdx)))
+			continue;
+
+		if (g_saSTM_Burst[ucChannelIdx].m_ucGood || (g_saSTM_Health[ucChannelIdx].m_ucFailRun >= STM_HEALTH_FAIL_LIMIT))
+			ucChannelMask &= ~(1 << ucChannelIdx);
+		else if (g_saSTM_Health[ucChannelIdx].m_uiRetries != 0xFFFF)
+			g_saSTM_Health[ucChannelIdx].m_uiRetries++;
+	}
+
+	return ucChannelMask;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Checks if a channel sits out this measurement
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+//! \return 1 if the channel is skipped, it reports STM_ERROR_CODE_4
+/////////////////////////////////////////////////////////////////////////
+static uint8 ucSTM_HealthSkip(uint8 ucChannelIdx)
+{
+	if (g_saSTM_Health[ucChannelIdx].m_ucSkip == 0)
+		return 0;
+
+	g_saSTM_Health[ucChannelIdx].m_ucSkip--;
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Updates the health of a channel with the result of a measurement
+//!
+//! Once STM_HEALTH_FAIL_LIMIT measurements in a row have failed the channel
+//! skips the next one, then twice as many after every failed probe, up to
+//! 2^STM_HEALTH_SKIP_SHIFT.  A good measurement ends the skipping.
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4; cResult, the result of the measurement
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_HealthUpdate(uint8 ucChannelIdx, char cResult)
+{
+	S_STM_Health *pHealth;
+	uint8 ucShift;
+
+	pHealth = &g_saSTM_Health[ucChannelIdx];
+
+	if (cResult == 0)
+	{
+		pHealth->m_ucFailRun = 0;
+		pHealth->m_ucSkip = 0;
+		return;
+	}
+
+	// A weak supply says nothing about the sensor
+	if ((cResult != STM_ERROR_CODE_1) && (cResult != STM_ERROR_CODE_2))
+		return;
+
+	if (pHealth->m_uiFailures != 0xFFFF)
+		pHealth->m_uiFailures++;
+	if (pHealth->m_ucFailRun != 0xFF)
+		pHealth->m_ucFailRun++;
+
+	if (pHealth->m_ucFailRun >= STM_HEALTH_FAIL_LIMIT)
+	{
+		ucShift = pHealth->m_ucFailRun - STM_HEALTH_FAIL_LIMIT;
+		if (ucShift > STM_HEALTH_SKIP_SHIFT)
+			ucShift = STM_HEALTH_SKIP_SHIFT;
+		pHealth->m_ucSkip = 1 << ucShift;
+	}
+}
+
+#if DIAG_ENABLED
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Adds a measurement time to the average of a channel
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4; ulTicks, the time in diagnostics ticks
+/////////////////////////////////////////////////////////////////////////
+static void vSTM_DurationUpdate(uint8 ucChannelIdx, uint32 ulTicks)
+{
+	uint16 uiMs;
+
+	// Limited so the average can not overflow
+	if (ulTicks >= ((uint32) (0xFFFF >> STM_DURATION_SHIFT) * STM_TICKS_PER_MS))
+		uiMs = 0xFFFF >> STM_DURATION_SHIFT;
+	else
+		uiMs = (uint16) (ulTicks / STM_TICKS_PER_MS);
+
+	// The first measurement seeds the average
+	if (g_uiaSTM_Duration[ucChannelIdx] == 0)
+		g_uiaSTM_Duration[ucChannelIdx] = uiMs << STM_DURATION_SHIFT;
+	else
+		g_uiaSTM_Duration[ucChannelIdx] += uiMs - (g_uiaSTM_Duration[ucChannelIdx] >> STM_DURATION_SHIFT);
+
+	// Keep a measured channel apart from one that never was
+	if (g_uiaSTM_Duration[ucChannelIdx] == 0)
+		g_uiaSTM_Duration[ucChannelIdx] = 1;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns the average measurement time of a channel
+//!
+//! \param ucChannel, 1 = STM1 ... 4 = STM4
+//! \return The time in ms rounded, 0 if the channel has not been measured
+/////////////////////////////////////////////////////////////////////////
+uint16 uiSTM_GetDurationMs(uint8 ucChannel)
+{
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS) || (g_uiaSTM_Duration[ucChannel - 1] == 0))
+		return 0;
+
+	return (g_uiaSTM_Duration[ucChannel - 1] + (1 << (STM_DURATION_SHIFT - 1))) >> STM_DURATION_SHIFT;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Copies the health of every channel into a reply payload
+//!
+//! Per channel from STM1 on: the failed measurements in a row, the
+//! measurements still to skip, then the failed measurements and the retries
+//! since the reset, low byte first.  The totals stop at 0xFFFF.
+//!
+//! \param pucBuff, the payload of the reply
+//! \return The length of the payload, STM_HEALTH_LENGTH
+/////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_FetchHealth(uint8 *pucBuff)
+{
+	uint8 ucChannelIdx;
+
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		*pucBuff++ = g_saSTM_Health[ucChannelIdx].m_ucFailRun;
+		*pucBuff++ = g_saSTM_Health[ucChannelIdx].m_ucSkip;
+		*pucBuff++ = (uint8) g_saSTM_Health[ucChannelIdx].m_uiFailures;
+		*pucBuff++ = (uint8) (g_saSTM_Health[ucChannelIdx].m_uiFailures >> 8);
+		*pucBuff++ = (uint8) g_saSTM_Health[ucChannelIdx].m_uiRetries;
+		*pucBuff++ = (uint8) (g_saSTM_Health[ucChannelIdx].m_uiRetries >> 8);
+	}
+
+	return STM_HEALTH_LENGTH;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Sets the number of frames per measurement of a channel
+//!
+//! The count is clamped to 1 ... STM_BURST_MAX and kept across resets.
+//!
+//! \param ucChannel, 1 = STM1 ... 4 = STM4; ucFrames, frames per measurement
+//! \return 0 on success, 1 if there is no such channel
+/////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_SetBurst(uint8 ucChannel, uint8 ucFrames)
+{
+	uint16 uiaFrames[NUM_STM_CHANNELS / 2];
+	uint8 ucIdx;
+
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return 1;
+
+	if (ucFrames == 0)
+		ucFrames = 1;
+	else if (ucFrames > STM_BURST_MAX)
+		ucFrames = STM_BURST_MAX;
+
+	if (g_ucaSTM_BurstFrames[ucChannel - 1] == ucFrames)
+		return 0;
+
+	g_ucaSTM_BurstFrames[ucChannel - 1] = ucFrames;
+
+	for (ucIdx = 0; ucIdx < NUM_STM_CHANNELS / 2; ucIdx++)
+		uiaFrames[ucIdx] = g_ucaSTM_BurstFrames[2 * ucIdx] | ((uint16) g_ucaSTM_BurstFrames[2 * ucIdx + 1] << 8);
+	ucConfig_Write(CONFIG_KEY_STM_BURST, uiaFrames, NUM_STM_CHANNELS / 2);
+
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns the number of frames per measurement of a channel
+//!
+//! \param ucChannel, 1 = STM1 ... 4 = STM4
+//! \return 1 ... STM_BURST_MAX, 0 if there is no such channel
+/////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_GetBurst(uint8 ucChannel)
+{
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return 0;
+
+	return g_ucaSTM_BurstFrames[ucChannel - 1];
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Loads the sensor types, timing profiles and bursts found before the last reset
+//!
+//! The config store must be initialized.  Channels never seen keep
+//! STM_TYPE_UNKNOWN and a single frame per measurement.
+//!
+/////////////////////////////////////////////////////////////////////////
+void vSTM_LoadSensorTypes(void)
+{
+	uint16 uiaTypes[NUM_STM_CHANNELS / 2];
+	uint8 ucIdx;
+
+	ucConfig_Read(CONFIG_KEY_STM_LATENCY, g_uiaSTM_LatencyMs, STM_NUM_PROFILES);
+
+	if (!ucConfig_Read(CONFIG_KEY_STM_BURST, uiaTypes, NUM_STM_CHANNELS / 2))
+	{
+		for (ucIdx = 0; ucIdx < NUM_STM_CHANNELS; ucIdx++)
+		{
+			g_ucaSTM_BurstFrames[ucIdx] = (uint8) (uiaTypes[ucIdx >> 1] >> (8 * (ucIdx & 1)));
+			if ((g_ucaSTM_BurstFrames[ucIdx] == 0) || (g_ucaSTM_BurstFrames[ucIdx] > STM_BURST_MAX))
+				g_ucaSTM_BurstFrames[ucIdx] = 1;
+		}
+	}
+
+	if (ucConfig_Read(CONFIG_KEY_SENSOR_TYPES, uiaTypes, NUM_STM_CHANNELS / 2))
+		return;
+
+	for (ucIdx = 0; ucIdx < NUM_STM_CHANNELS / 2; ucIdx++)
+	{
+		g_ucaSTM_SensorType[2 * ucIdx] = (uint8) uiaTypes[ucIdx];
+		g_ucaSTM_SensorType[2 * ucIdx + 1] = (uint8) (uiaTypes[ucIdx] >> 8);
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //!   \brief Initializes the STM program
 //!
@@ -113,120 +655,442 @@ void vSTM_Initialize(void)
 		g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] = 0xFF;
 
 	g_ucSTM_RXBufferIndex = 0x00;
+
+	// No batch in progress or waiting to be read
+	g_ucSTM_BatchActive = 0;
+	g_ucSTM_BatchReady = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
 //!
-//! \brief Reads from the desired soil moisture sensor
+//! \brief Receives one frame from several soil moisture sensors in one excite cycle
 //!
+//! Every frame is added to the burst of its channel.
 //!
-//! \param ucSensor
+//! \param ucChannelMask, bit 0 = STM1 ... bit 3 = STM4
+//! \return The length of the excite cycle in ms, 0 for no channels
+/////////////////////////////////////////////////////////////////////////
+static uint16 uiSTM_BatchPass(uint8 ucChannelMask)
+{
+	uint8 ucChannelIdx;
+	uint8 ucExciteBits;
+	uint16 uiSettleMs;
+	uint16 uiEndMs;
+
+	// Reset the receive state of the requested channels.  The RX window opens
+	// for the earliest sensor in the batch and closes for the slowest one.
+	ucExciteBits = 0;
+	uiSettleMs = 0xFFFF;
+	uiEndMs = 0;
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		if (ucChannelMask & (1 << ucChannelIdx))
+		{
+			ucExciteBits |= g_ucaSTM_ExciteBits[ucChannelIdx];
+			g_saSTM_BatchChannel[ucChannelIdx].m_ucBitsLeft = 0;
+			vSTM_ParseReset(ucChannelIdx);
+
+			if (uiSTM_GetSettleMs(ucChannelIdx) < uiSettleMs)
+				uiSettleMs = uiSTM_GetSettleMs(ucChannelIdx);
+			if (uiSTM_GetEndMs(ucChannelIdx) > uiEndMs)
+				uiEndMs = uiSTM_GetEndMs(ucChannelIdx);
+		}
+	}
+
+	if (!ucExciteBits)
+		return 0;
+
+	TBCCTL1 &= ~CCIE;
+	TBCCTL0 &= ~CCIE;
+	STM_TIMER_START();
+	P_STM_PWR_OUT |= ucExciteBits; //START exciting all the STMs
+	vPWR_StartSupply(); // Sample the supply under load, done long before the settle delay
+
+	// ******************Delay for Level Shifter Bug*******************************************************
+	// At least STM_POWER_UP_MS, up to the learned first start bit when it is known
+	DIAG_BEGIN(DIAG_PHASE_STM_SETTLE);
+	vSTM_StartDeadline(uiSettleMs);
+	ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_SETTLE);
+	// **********************************************************************************
+
+	// Start the sampler, it runs off TBCCR1 without stopping the timer
+	vSTM_StartDeadline(uiEndMs - uiSettleMs);
+	g_ucSTM_BatchActive = ucChannelMask;
+	TBCCR1 = TBR + STM_BATCH_TICK;
+	TBCCTL1 = CCIE;
+
+	// Sleep until the sampler has every packet or the deadline passes
+	DIAG_BEGIN(DIAG_PHASE_STM_RECEIVE);
+	ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_RECEIVE);
+
+	// Stop the sampler and the deadline and turn off the sensors that did not finish
+	TBCCTL1 &= ~CCIE;
+	TBCCTL2 &= ~CCIE;
+	P_STM_PWR_OUT &= ~ucExciteBits; //END exciting the STMs
+	STM_TIMER_STOP();
+
+	// The parsers finished each frame as it came in, only the results are left to pick up.
+	// A channel that never finished keeps the STM_ERROR_CODE_2 the parser started with.
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		if (!(ucChannelMask & (1 << ucChannelIdx)))
+			continue;
+
+		vSTM_FinishRead(ucChannelIdx, uiEndMs);
+		vSTM_BurstAdd(ucChannelIdx);
+	}
+
+	g_ucSTM_BatchActive = 0;
+
+	return uiEndMs;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Reads from several soil moisture sensors in one excite cycle
 //!
+//! All channels in the mask are powered together and received in parallel
+//! by the batch sampler in TIMERB1_ISR, so a full sweep takes about as long
+//! as a single sensor.  A channel with a burst takes part in as many excite
+//! cycles as it has frames, the channels left without a good frame are
+//! retried together like in cSTM_Measure(). The results are held until
+//! cSTM_Measure() is called for each channel.
+//!
+//! \param ucChannelMask, bit 0 = STM1 ... bit 3 = STM4
 /////////////////////////////////////////////////////////////////////////
-char cSTM_Measure(uint8 ucChannel)
+void vSTM_MeasureBatch(uint8 ucChannelMask)
 {
 	uint8 ucChannelIdx;
-	uint8 ucaSTMExciteBits[4] = { cSTM_1_PWR_PIN, cSTM_2_PWR_PIN, cSTM_3_PWR_PIN, cSTM_4_PWR_PIN };
-	uint8 ucaSTMRXBits[4] = { cSTM_1_RX_PIN, cSTM_2_RX_PIN, cSTM_3_RX_PIN, cSTM_4_RX_PIN };
+	uint8 ucChannelBit;
+	uint8 ucPassMask;
+	uint8 ucFrame;
+	uint8 ucFrames;
+	uint16 uiPassMs;
+	uint16 uiSpentMs;
+	uint16 uiRestMs;
+#if DIAG_ENABLED
+	uint32 ulStart;
+#endif
+
+	ucChannelMask &= STM_ALL_CHANNELS;
+
+	// Discard results of older batches for these channels
+	g_ucSTM_BatchReady &= ~ucChannelMask;
+
+	// Channels sitting out are answered without exciting them
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		ucChannelBit = 1 << ucChannelIdx;
+		if ((ucChannelMask & ucChannelBit) && ucSTM_HealthSkip(ucChannelIdx))
+		{
+			g_caSTM_BatchResult[ucChannelIdx] = STM_ERROR_CODE_4;
+			g_ucSTM_BatchReady |= ucChannelBit;
+			ucChannelMask &= ~ucChannelBit;
+		}
+	}
 
-	// Handle indexing starting at zero
-	ucChannelIdx = ucChannel - 1;
-	cSTM_RX_Pin = ucaSTMRXBits[ucChannelIdx];
+	// Hand out STM_ERROR_CODE_3 instead of exciting on a weak supply, a new sample lets the average recover
+	if (ucPWR_SupplyLow())
+	{
+		for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+		{
+			if (ucChannelMask & (1 << ucChannelIdx))
+				g_caSTM_BatchResult[ucChannelIdx] = STM_ERROR_CODE_3;
+		}
+		g_ucSTM_BatchReady |= ucChannelMask;
+		vPWR_StartSupply();
+		return;
+	}
+
+#if DIAG_ENABLED
+	// The channels are read together, each of them takes the time of the batch
+	ulStart = ulDiag_Tick();
+#endif
+
+	ucFrames = 0;
+	uiPassMs = 0;
+	uiSpentMs = 0;
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		if (ucChannelMask & (1 << ucChannelIdx))
+		{
+			vSTM_BurstReset(ucChannelIdx);
+			if (g_ucaSTM_BurstFrames[ucChannelIdx] > ucFrames)
+				ucFrames = g_ucaSTM_BurstFrames[ucChannelIdx];
+		}
+	}
+
+	for (ucFrame = 0; ucFrame < ucFrames; ucFrame++)
+	{
+		ucPassMask = 0;
+		for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+		{
+			if ((ucChannelMask & (1 << ucChannelIdx)) && (g_ucaSTM_BurstFrames[ucChannelIdx] > ucFrame))
+				ucPassMask |= (1 << ucChannelIdx);
+		}
+
+		if (ucFrame)
+		{
+			vSTM_BurstRest(STM_BURST_REST_MS);
+			uiSpentMs += STM_BURST_REST_MS;
+		}
+		uiPassMs = uiSTM_BatchPass(ucPassMask);
+		uiSpentMs += uiPassMs;
+	}
+
+	// Retry with a growing rest while a pass still fits in the budget
+	for (ucFrame = 0; ucFrame < STM_RETRIES; ucFrame++)
+	{
+		uiRestMs = uiSTM_GetRetryRestMs(uiSpentMs, ucFrame, uiPassMs);
+		if (!uiRestMs)
+			break;
+
+		ucPassMask = ucSTM_RetryMask(ucChannelMask);
+		if (!ucPassMask)
+			break;
+
+		vSTM_BurstRest(uiRestMs);
+		uiPassMs = uiSTM_BatchPass(ucPassMask);
+		uiSpentMs += uiRestMs + uiPassMs;
+	}
+
+	for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+	{
+		ucChannelBit = 1 << ucChannelIdx;
+		if (!(ucChannelMask & ucChannelBit))
+			continue;
+
+		g_caSTM_BatchResult[ucChannelIdx] = cSTM_BurstResult(ucChannelIdx, &g_laSTM_BatchSoil[ucChannelIdx],
+				&g_naSTM_BatchTemperature[ucChannelIdx], &g_uiaSTM_BatchSpread[ucChannelIdx]);
+		vSTM_HealthUpdate(ucChannelIdx, g_caSTM_BatchResult[ucChannelIdx]);
+		g_ucSTM_BatchReady |= ucChannelBit;
+
+#if DIAG_ENABLED
+		if (g_caSTM_BatchResult[ucChannelIdx] == 0)
+			vSTM_DurationUpdate(ucChannelIdx, ulDiag_Tick() - ulStart);
+#endif
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Receives one frame from a soil moisture sensor
+//!
+//! \param ucChannelIdx, 0 = STM1 ... 3 = STM4
+//! \return The result the parser is left with
+/////////////////////////////////////////////////////////////////////////
+static char cSTM_ReadFrame(uint8 ucChannelIdx)
+{
+	uint8 ucEvent;
+	uint16 uiSettleMs;
+	uint16 uiEndMs;
+
+	cSTM_RX_Pin = g_ucaSTM_RXBits[ucChannelIdx];
 	// Clear the RX buffer and reset index WAS here, but I don't think it's necessary. Just a reminder it's an option...
 
-	TBCTL = (TBSSEL_2 | TBCLR); //select SMCLK clear TBR
-	P_STM_PWR_OUT |= ucaSTMExciteBits[ucChannelIdx]; //START exciting the STM
+	// The ISR parses the frame as it arrives
+	g_ucSTM_RXChannelIdx = ucChannelIdx;
+	vSTM_ParseReset(ucChannelIdx);
+
+	// The RX window of the timing profile, the full timeout while it is not known
+	uiSettleMs = uiSTM_GetSettleMs(ucChannelIdx);
+	uiEndMs = uiSTM_GetEndMs(ucChannelIdx);
 
-	// ******************Delay for Level Shifter Bug*******************************************************
-	// Enable timer interrupt, configure for delay
-	TBCCR2 = 50000; //Equal to CPU delay 200000 (12.5 ms)
 	TBCCTL1 &= ~CCIE;
 	TBCCTL0 &= ~CCIE;
-	TBCCTL2 = CCIE; // Enable interrupts
-	TBCTL |= MC1; //Continuous Mode
+	STM_TIMER_START();
+	P_STM_PWR_OUT |= g_ucaSTM_ExciteBits[ucChannelIdx]; //START exciting the STM
+	vPWR_StartSupply(); // Sample the supply under load, done long before the settle delay
 
-	__bis_SR_register(LPM0_bits); //CPU asleep.
-
-	TBCTL &= ~TBIFG;
-	TBCCTL1 &= ~TBIFG; // Clear IFGs
+	// ******************Delay for Level Shifter Bug*******************************************************
+	DIAG_BEGIN(DIAG_PHASE_STM_SETTLE);
+	vSTM_StartDeadline(uiSettleMs);
+	ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_SETTLE);
 	// **********************************************************************************
 
+	g_ucSTM_RXBufferIndex = 0;
+
+	// In case there's no STM attached the end of the RX window ends the read.
+	// The timer free runs until the read is done, PORT1_ISR schedules the bit compares from TBR
+	vSTM_StartDeadline(uiEndMs - uiSettleMs);
+
 	//Enable the falling edge interrupt
-	P_STM_RX_IES |= ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IFG &= ~ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IE |= ucaSTMRXBits[ucChannelIdx];
+	P_STM_RX_IES |= g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IFG &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IE |= g_ucaSTM_RXBits[ucChannelIdx];
 
-	g_ucSTM_RXBufferIndex = 0;
+	//Sleep once, until the frame is in or the deadline passes
+	DIAG_BEGIN(DIAG_PHASE_STM_RECEIVE);
+	ucEvent = ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_RECEIVE);
+
+	//Disable Interrupt
+	P_STM_RX_IE &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IFG &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	TBCCTL1 &= ~CCIE;
+	TBCCTL2 &= ~CCIE;
+	g_ucSTM_RXBusy = 0;
+
+	//Turn off STM, TIMERB1_ISR already did at the end of a frame
+	P_STM_PWR_OUT &= ~g_ucaSTM_ExciteBits[ucChannelIdx]; //END exciting the STM
 
-	//In case there's no STM1 attached, time out after 3 timer B roll overs. Timer was already started and ready for IFG back in delay
-	TBCTL |= TBCLR;
-	timeoutcounter = 0;
+	STM_TIMER_STOP();
 
-	//Sleep until measurement is done
-	while (timeoutcounter < 10)
+	// The checksum and the values were worked out by the parser as the bytes came in
+	if (!(ucEvent & STM_EVENT_FRAME))
+		g_saSTM_Parser[ucChannelIdx].m_cResult = STM_ERROR_CODE_2;
+	vSTM_FinishRead(ucChannelIdx, uiEndMs);
+
+	return g_saSTM_Parser[ucChannelIdx].m_cResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Reads from the desired soil moisture sensor
+//!
+//! The channel is read as many times as its burst asks for, see
+//! ucSTM_SetBurst().  Without a good frame it is read again up to
+//! STM_RETRIES times, with a rest that doubles each time, as long as the
+//! measurement stays within STM_RETRY_BUDGET_MS.  A channel that keeps
+//! failing is skipped for a while, see vSTM_HealthUpdate().
+//!
+//! \param ucSensor
+//! \return 0 on success, else STM_ERROR_CODE_1 ... STM_ERROR_CODE_4
+/////////////////////////////////////////////////////////////////////////
+char cSTM_Measure(uint8 ucChannel)
+{
+	uint8 ucChannelIdx;
+	uint8 ucFrame;
+	uint16 uiSpentMs;
+	uint16 uiRestMs;
+	char cResult;
+#if DIAG_ENABLED
+	uint32 ulStart;
+#endif
+
+	// Handle indexing starting at zero
+	ucChannelIdx = ucChannel - 1;
+
+#if STM_BATCH_ENABLED
+	// If this channel was just read by vSTM_MeasureBatch() hand out that result
+	if (g_ucSTM_BatchReady & (1 << ucChannelIdx))
 	{
-		__bis_SR_register(LPM0_bits); //CPU asleep.
-		//CPU asleep.
-		timeoutcounter++;
-		// Break out if we have received the packet from the sensor
-		if ((g_ucSTM_RXBufferIndex > 0) && (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex - 1] == 0x0A))
-			break;
+		g_ucSTM_BatchReady &= ~(1 << ucChannelIdx);
+		lSTM_Soil = g_laSTM_BatchSoil[ucChannelIdx];
+		nSTM_Temperature = g_naSTM_BatchTemperature[ucChannelIdx];
+		uiSTM_Spread = g_uiaSTM_BatchSpread[ucChannelIdx];
+		return g_caSTM_BatchResult[ucChannelIdx];
 	}
+#endif
 
-	//Disable Interrupt
-	P_STM_RX_IE &= ~ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IFG &= ~ucaSTMRXBits[ucChannelIdx];
+	// A channel that keeps failing sits out, the sweep does not wait for it
+	if (ucSTM_HealthSkip(ucChannelIdx))
+		return STM_ERROR_CODE_4;
 
-	//Turn off STM
-	P_STM_PWR_OUT &= ~ucaSTMExciteBits[ucChannelIdx]; //END exciting the STM
+	// Do not excite on a weak supply, a new sample lets the average recover
+	if (ucPWR_SupplyLow())
+	{
+		vPWR_StartSupply();
+		return STM_ERROR_CODE_3;
+	}
 
-	TBCTL = TBCLR; //Clear Timer
+#if DIAG_ENABLED
+	ulStart = ulDiag_Tick();
+#endif
 
-	if (timeoutcounter >= 10)
-		return 2;
+	vSTM_BurstReset(ucChannelIdx);
+	uiSpentMs = 0;
+	for (ucFrame = 0; ucFrame < g_ucaSTM_BurstFrames[ucChannelIdx]; ucFrame++)
+	{
+		if (ucFrame)
+		{
+			vSTM_BurstRest(STM_BURST_REST_MS);
+			uiSpentMs += STM_BURST_REST_MS;
+		}
+		uiSpentMs += uiSTM_GetEndMs(ucChannelIdx);
+		cSTM_ReadFrame(ucChannelIdx);
+		vSTM_BurstAdd(ucChannelIdx);
+	}
 
-	// verify message integrity
-	if (cSTM_Test_Checksum())
-		return 1;
+	// Retry with a growing rest while a read still fits in the budget
+	for (ucFrame = 0; ucFrame < STM_RETRIES; ucFrame++)
+	{
+		uiRestMs = uiSTM_GetRetryRestMs(uiSpentMs, ucFrame, uiSTM_GetEndMs(ucChannelIdx));
+		if (!uiRestMs)
+			break;
 
-	// Parse the message
-	cSTM_ReadValue();
-	return 0;
+		if (!ucSTM_RetryMask(1 << ucChannelIdx))
+			break;
+
+		vSTM_BurstRest(uiRestMs);
+		uiSpentMs += uiRestMs + uiSTM_GetEndMs(ucChannelIdx);
+		cSTM_ReadFrame(ucChannelIdx);
+		vSTM_BurstAdd(ucChannelIdx);
+	}
+
+	cResult = cSTM_BurstResult(ucChannelIdx, &lSTM_Soil, &nSTM_Temperature, &uiSTM_Spread);
+	vSTM_HealthUpdate(ucChannelIdx, cResult);
 
+#if DIAG_ENABLED
+	if (cResult == 0)
+		vSTM_DurationUpdate(ucChannelIdx, ulDiag_Tick() - ulStart);
+#endif
 
+	return cResult;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Tests whether the returned Checksum is correct -> Transmission
-//!		was free of errors, or the error compensates itself(possible but unlikely.)
+//!   \brief Arms the TBCCR2 deadline and clears the frame events
 //!
+//!   TimerB must be running from SMCLK.  Deadlines longer than
+//!   STM_DEADLINE_CHUNK_MS are continued from TIMERB1_ISR.
 //!
-//!   \param char arg: 	1: Evaluate Sensor 1
-//!						2: Evaluate Sensor 2
-//!						3: Evaluate both Sensor 1 and 2
-//!
-//!   \return 1: Checksum ok
-//!			  0: Checksum fail or parameter fail
+//!   \param uiMs, the deadline in milliseconds from now
+//!   \return none
 ///////////////////////////////////////////////////////////////////////////////
-char cSTM_Test_Checksum(void)
+void vSTM_StartDeadline(uint16 uiMs)
 {
-	int add = 0;
+	uint16 uiChunkMs;
 
-	g_ucSTM_RXBufferIndex = 0;
+	if (uiMs == 0)
+		uiMs = 1;
+
+	uiChunkMs = (uiMs > STM_DEADLINE_CHUNK_MS) ? STM_DEADLINE_CHUNK_MS : uiMs;
+	g_uiSTM_DeadlineMsLeft = uiMs - uiChunkMs;
+	g_ucSTM_Event = 0;
 
-	do
+	TBCCR2 = TBR + (uiChunkMs * STM_TICKS_PER_MS);
+	TBCCTL2 = CCIE; // Clears any stale CCIFG as well
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Sleeps until a frame event is raised
+//!
+//!   Interrupts are off between the test and the sleep so an event can not
+//!   slip in unnoticed.  Wake ups for anything else put the CPU straight back
+//!   to sleep.
+//!
+//!   \param none
+//!   \return The STM_EVENT_ flags that were raised
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_WaitForEvent(void)
+{
+	uint8 ucEvent;
+
+	__disable_interrupt();
+	while (!g_ucSTM_Event)
 	{
-		add += g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex];
-		g_ucSTM_RXBufferIndex++;
+		__bis_SR_register(LPM0_bits | GIE); //CPU asleep.
+		__disable_interrupt();
 	}
-	while (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] != 0xD);
-	add += g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex]; //Add the 0xD
-	add += g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex + 1]; //Add one more (x or z)
-	add = (add % 64) + 32;
-	if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex + 2] == add)
-		return 0;
+	ucEvent = g_ucSTM_Event;
+	g_ucSTM_Event = 0;
+	__enable_interrupt();
 
-	return 1; //It failed
+	return ucEvent;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -248,105 +1112,73 @@ uint8 cSTM_RequestSensorType(uint8 ucChannel)
 
 	uint8 ucSensorType;
 	uint8 ucChannelIdx;
-	uint8 ucaSTMExciteBits[4] = { cSTM_1_PWR_PIN, cSTM_2_PWR_PIN, cSTM_3_PWR_PIN, cSTM_4_PWR_PIN };
-	uint8 ucaSTMRXBits[4] = { cSTM_1_RX_PIN, cSTM_2_RX_PIN, cSTM_3_RX_PIN, cSTM_4_RX_PIN };
+	uint8 ucEvent;
 
 	// Handle indexing starting at zero
 	ucChannelIdx = ucChannel - 1;
-	cSTM_RX_Pin = ucaSTMRXBits[ucChannelIdx];
+	cSTM_RX_Pin = g_ucaSTM_RXBits[ucChannelIdx];
 	// Clear the RX buffer and reset index WAS here, but I don't think it's necessary. Just a reminder it's an option...
 
-	TBCTL = (TBSSEL_2 | TBCLR); //select SMCLK clear TBR
-	P_STM_PWR_OUT |= ucaSTMExciteBits[ucChannelIdx]; //START exciting the STM
+	// The ISR parses the frame as it arrives
+	g_ucSTM_RXChannelIdx = ucChannelIdx;
+	vSTM_ParseReset(ucChannelIdx);
 
-	// ******************Delay for Level Shifter Bug*******************************************************
-	// Enable timer interrupt, configure for delay
-	TBCCR2 = 50000; //Equal to CPU delay 200000 (12.5 ms)
 	TBCCTL1 &= ~CCIE;
 	TBCCTL0 &= ~CCIE;
-	TBCCTL2 = CCIE; // Enable interrupts
-	TBCTL |= MC1; //Continuous Mode
+	STM_TIMER_START();
+	P_STM_PWR_OUT |= g_ucaSTM_ExciteBits[ucChannelIdx]; //START exciting the STM
 
-	__bis_SR_register(LPM0_bits); //CPU asleep.
-
-	TBCTL &= ~TBIFG;
-	TBCCTL1 &= ~TBIFG; // Clear IFGs
+	// ******************Delay for Level Shifter Bug*******************************************************
+	DIAG_BEGIN(DIAG_PHASE_STM_SETTLE);
+	vSTM_StartDeadline(STM_POWER_UP_MS);
+	ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_SETTLE);
 	// **********************************************************************************
 
-	//Enable the falling edge interrupt
-	P_STM_RX_IES |= ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IFG &= ~ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IE |= ucaSTMRXBits[ucChannelIdx];
-
 	g_ucSTM_RXBufferIndex = 0;
 
-	//In case there's no STM1 attached, time out after 3 timer B roll overs. Timer was already started and ready for IFG back in delay
-	TBCTL |= TBCLR;
-	timeoutcounter = 0;
+	// In case there's no STM attached the deadline for an unknown sensor ends the read.
+	// The timer free runs until the read is done, PORT1_ISR schedules the bit compares from TBR
+	vSTM_StartDeadline(STM_TIMEOUT_MS_DEFAULT);
 
-	//Sleep until measurement is done
-	while (timeoutcounter < 3)
-	{
-		__bis_SR_register(LPM0_bits); //CPU asleep.
-		//CPU asleep.
-		timeoutcounter++;
-		// Break out if we have received the packet from the sensor
-		if ((g_ucSTM_RXBufferIndex > 0) && (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex - 1] == 0x0A))
-			break;
-	}
+	//Enable the falling edge interrupt
+	P_STM_RX_IES |= g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IFG &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IE |= g_ucaSTM_RXBits[ucChannelIdx];
+
+	//Sleep once, until the frame is in or the deadline passes
+	DIAG_BEGIN(DIAG_PHASE_STM_RECEIVE);
+	ucEvent = ucSTM_WaitForEvent();
+	DIAG_END(DIAG_PHASE_STM_RECEIVE);
 
 	//Disable Interrupt
-	P_STM_RX_IE &= ~ucaSTMRXBits[ucChannelIdx];
-	P_STM_RX_IFG &= ~ucaSTMRXBits[ucChannelIdx];
+	P_STM_RX_IE &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	P_STM_RX_IFG &= ~g_ucaSTM_RXBits[ucChannelIdx];
+	TBCCTL1 &= ~CCIE;
+	TBCCTL2 &= ~CCIE;
+	g_ucSTM_RXBusy = 0;
 
 	//Turn off STM
-	P_STM_PWR_OUT &= ~ucaSTMExciteBits[ucChannelIdx]; //END exciting the STM
+	P_STM_PWR_OUT &= ~g_ucaSTM_ExciteBits[ucChannelIdx]; //END exciting the STM
 
-	TBCTL = TBCLR; //Clear Timer
+	STM_TIMER_STOP();
 
-	if (timeoutcounter >= 3)
+	if (!(ucEvent & STM_EVENT_FRAME))
 		return 2;
 
 	// verify message integrity
-	if (cSTM_Test_Checksum())
-		return 1;
+	if (g_saSTM_Parser[ucChannelIdx].m_cResult)
+		return g_saSTM_Parser[ucChannelIdx].m_cResult;
 
-	// Parse the message
-	//cSTM_ReadValue();
-	//return 0;
+	// The parser kept the byte following the carriage return
+	ucSensorType = g_saSTM_Parser[ucChannelIdx].m_ucSensorType;
 
-	// Search the RX buffer to determine the sensor type
-	for (g_ucSTM_RXBufferIndex = 0; g_ucSTM_RXBufferIndex < RX_BUFFER_SIZE_STM; g_ucSTM_RXBufferIndex++)
-	{
-		// If we found the carriage return the next byte is the sensor type
-		if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] == 0x0D)
-		{
-			ucSensorType = g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex + 1];
-			break;
-		}
-	}
+	// Keep it, also across a reset
+	vSTM_SetSensorType(ucChannelIdx, ucSensorType);
 
-	// assign type value to appropriate global var
-	switch(ucChannel){
-		case 1:
-			uiSTM1_type = ucSensorType;
-			break;
-
-		case 2:
-			uiSTM2_type = ucSensorType;
-			break;
-
-		case 3:
-			uiSTM3_type = ucSensorType;
-			break;
-
-		case 4:
-			uiSTM4_type = ucSensorType;
-			break;
-
-		default:
-			break;
-	}
+	// A sensor answered, stop skipping the channel
+	g_saSTM_Health[ucChannelIdx].m_ucFailRun = 0;
+	g_saSTM_Health[ucChannelIdx].m_ucSkip = 0;
 
 	// indicates success
 	return 0;
@@ -354,174 +1186,32 @@ uint8 cSTM_RequestSensorType(uint8 ucChannel)
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //!
-//! \brief Returns the sensor type currently stored to a particular channel's global var
+//! \brief Returns the sensor type last seen on a channel
 //!
 ///////////////////////////////////////////////////////////////////////////////////////////////
 uint8 cSTM_ReturnSensorType(uint8 ucChannel)
 {
-	switch(ucChannel)
-	{
-		case 1:
-			return uiSTM1_type;
-
-		case 2:
-			return uiSTM2_type;
-
-		case 3:
-			return uiSTM3_type;
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return STM_TYPE_UNKNOWN;
 
-		case 4:
-			return uiSTM4_type;
-
-		default:
-			return 0x52;
-	}
+	return g_ucaSTM_SensorType[ucChannel - 1];
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////
-//!
-//! \brief Parses the message from the soil moisture sensor.
-//!  This is designed to automatically determine the type of sensor (5TM, 5TE, MPS6)
-//!  based on the sensors message.  The byte following the carriage return is the sensor type.
-//!
-//! z = 5TE
-//! x = 5TM
-//! l = MPS6
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns a count that changes whenever a sensor type changes
 //!
+//! Anything built from the sensor types is current while the count it was
+//! built with is returned.
 //!
-///////////////////////////////////////////////////////////////////////////////////////////////
-void cSTM_ReadValue(void)
+//!   \return g_ucSTM_TypeGen
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_GetTypeGen(void)
 {
-	uint8 ucSensorType;
-	uint32 ulMult = 1;
-
-	// Search the RX buffer to determine the sensor type
-	for (g_ucSTM_RXBufferIndex = 0; g_ucSTM_RXBufferIndex < RX_BUFFER_SIZE_STM; g_ucSTM_RXBufferIndex++)
-	{
-		// If we found the carriage return the next byte is the sensor type
-		if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] == 0x0D)
-		{
-			ucSensorType = g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex + 1];
-			break;
-		}
-	}
-
-	// At this point the RX buffer Index is pointing at the carriage return (0x0D)
-	// From here we can go backwards through the buffer converting the ascii values
-	// to decimal
-	switch (ucSensorType)
-	{
-		case FIVETM:
-			// Clear the temperature and soil moisture variable
-			nSTM_Temperature = 0;
-			lSTM_Soil = 0;
-
-			// Initialize the multiplier
-			ulMult = 1;
-
-			// Convert the soil temperature from ascii to decimal
-			while (g_ucaSTM_RXBuffer[--g_ucSTM_RXBufferIndex] != 0x20 && g_ucSTM_RXBufferIndex != 0) //0x20 is a " "
-			{
-				nSTM_Temperature += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-			}
-
-			// Decrement the index to point to the soil moisture
-			g_ucSTM_RXBufferIndex -= 2;
-
-			// Initialize the multiplier
-			ulMult = 1;
-
-			// Convert the Soil moisture from ascii to decimal
-			while (g_ucSTM_RXBufferIndex-- != 0)
-			{
-				lSTM_Soil += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-			}
-
-		break;
-
-		case FIVETE:
-			// Clear the temperature and soil moisture variable
-			nSTM_Temperature = 0;
-			lSTM_Soil = 0;
-
-			// Initialize the multiplier
-			ulMult = 1;
-
-			// Loop backwards until we have reached the end of the temperature reading
-			while (g_ucaSTM_RXBuffer[--g_ucSTM_RXBufferIndex] != 0x20 && g_ucSTM_RXBufferIndex != 0) //0x20 is a " "
-			{
-				nSTM_Temperature += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-			}
-
-			// Loop backwards until we have reached the soil moisture reading
-			while (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex--] != 0x20 && g_ucSTM_RXBufferIndex != 0)
-				; //0x20 is a " "
-
-			// Initialize the multiplier
-			ulMult = 1;
-
-			while (g_ucSTM_RXBufferIndex-- != 0)
-			{
-				lSTM_Soil += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-			}
-
-		break;
-
-		case MPS6:
-			// Initialize the soil moisture, soil temperature variables
-			lSTM_Soil = 0;
-			nSTM_Temperature = 0;
-
-			// Start the multiplier at 1
-			ulMult = 1;
-
-			// Loop backwards until we have reached the end of the temperature reading
-			while (g_ucaSTM_RXBuffer[--g_ucSTM_RXBufferIndex] != 0x20 && g_ucSTM_RXBufferIndex != 0)
-			{
-				// Ignore the decimal point
-				if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] == 0x2E)
-					continue;
-
-				nSTM_Temperature += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-
-				// If the temperature is negative then multiply by -1
-				if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] == 0x2D)
-					nSTM_Temperature = -1 * nSTM_Temperature;
-			}
-
-			g_ucSTM_RXBufferIndex--; //Skip the ' '
-
-			// Reset the multiplier
-			ulMult = 1;
-
-			// Loop back and convert until we reach the negative sign (0x2D)
-			while (g_ucaSTM_RXBuffer[--g_ucSTM_RXBufferIndex] != 0x2D)
-			{
-				// Ignore the decimal point
-				if (g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] == 0x2E)
-					continue;
-
-				lSTM_Soil += ((g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex] - 48) * ulMult);
-				ulMult *= 10;
-			}
-			// For the MPS6 the soil moisture values are always negative
-			lSTM_Soil *= -1;
-
-		break;
-
-		default:
-		break;
-
-	} //End: switch()
-} //End:cSTM_ReadValue
+	return g_ucSTM_TypeGen;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Returns Soil Moisture value
+//!   \brief Returns Soil Moisture value, decoded for the sensor type, see the STM Decoders
 //!
 //!   \return lSTM_Soil
 ///////////////////////////////////////////////////////////////////////////////
@@ -531,7 +1221,7 @@ int32 lSTM_GetSoil(void)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Returns Soil Temperature value
+//!   \brief Returns Soil Temperature value in degrees C x10
 //!
 //!
 //!   \return Temperature
@@ -541,6 +1231,20 @@ int iSTM_GetTemp(void)
 	return nSTM_Temperature;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the spread of the last burst
+//!
+//!   The difference of the highest and the lowest good soil moisture value,
+//!   in the units of lSTM_GetSoil(), 0 for a burst of one frame and at most
+//!   0x7FFF.
+//!
+//!   \return uiSTM_Spread
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiSTM_GetSpread(void)
+{
+	return uiSTM_Spread;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ////!   \brief Second Interrupt Handler for TimerB (TimerB0 is the other)
 ////!
@@ -89,6 +89,347 @@
 
 #define RX_BUFFER_SIZE_STM 	   20
 
+//! \def STM_FIRST_BIT_DELAY
+//! \brief Timer count from the start bit edge to the middle of the first data bit
+#define STM_FIRST_BIT_DELAY		(BAUD_1200 + BAUD_1200_DELAY)
+
+//******************  STM Batch Acquisition  *****************************************//
+//! @name STM Batch Acquisition
+//! Batched acquisition powers every requested channel at once and receives
+//! all of the RX lines in parallel from a single oversampling TimerB sampler.
+//! @{
+
+//! \def STM_BATCH_ENABLED
+//! \brief Set to 1 to measure all channels of a COMMAND_PKT in one excite cycle
+#define STM_BATCH_ENABLED		1
+
+//! \def NUM_STM_CHANNELS
+//! \brief The number of STM channels on the board
+#define NUM_STM_CHANNELS		4
+
+//! \def STM_ALL_CHANNELS
+//! \brief Channel mask covering every STM channel (bit 0 = STM1)
+#define STM_ALL_CHANNELS		0x0F
+
+//! \def STM_BATCH_OVERSAMPLE
+//! \brief Number of sampler ticks per bit at 1200 baud
+#define STM_BATCH_OVERSAMPLE	4
+
+//! \def STM_BATCH_TICK
+//! \brief Timer count between sampler ticks, computed for 4MHz SMCLK
+#define STM_BATCH_TICK			(BAUD_1200 / STM_BATCH_OVERSAMPLE)
+
+//! \def STM_BATCH_FIRST_SAMPLE
+//! \brief Ticks from start bit detection to the middle of the first data bit
+#define STM_BATCH_FIRST_SAMPLE	(STM_BATCH_OVERSAMPLE + STM_BATCH_OVERSAMPLE/2)
+
+//! \def STM_BITS_PER_FRAME
+//! \brief Number of samples per byte after the start bit (8 data bits + stop bit)
+#define STM_BITS_PER_FRAME		9
+
+//! \struct S_STM_BatchChannel
+//! \brief Receive state of one channel in the batch sampler
+typedef struct
+{
+	uint8 m_ucTicks;			//!< Sampler ticks until the next bit sample
+	uint8 m_ucBitsLeft;		//!< Samples left in the current byte, 0 while waiting for a start bit
+	uint8 m_ucShift;			//!< The byte being assembled
+} S_STM_BatchChannel;
+//! @}
+
+//! @name STM TimerB Control
+//! With DIAG_ENABLED TimerB free runs as the diagnostics clock, so the STM
+//! reads only use its compare registers and leave it running.
+//! @{
+#if DIAG_ENABLED
+#define STM_TIMER_START()
+#define STM_TIMER_STOP()
+#else
+#define STM_TIMER_START()	{ TBCTL = (TBSSEL_2 | TBCLR); TBCTL |= MC1; }	//!< SMCLK, continuous mode
+#define STM_TIMER_STOP()	{ TBCTL = TBCLR; }								//!< Stop and clear TimerB
+#endif
+//! @}
+
+//! @name Sensor Types
+//! The sensor type byte that follows the carriage return of a frame
+//! @{
+//! \def MPS6
+//! \brief Decagon's code indicating sensor is MPS6
+#define MPS6	0x6C
+//! \def FIVETM
+//! \brief Decagon's code indicating sensor is  5TM
+#define FIVETM	0x78
+//! \def FIVETE
+//! \brief Decagon's code indicating sensor is  5TE
+#define FIVETE	0x7A
+//! \def STM_TYPE_UNKNOWN
+//! \brief The type of a channel that has never sent a frame
+#define STM_TYPE_UNKNOWN	0x52
+//! @}
+
+//******************  STM Frame Parser  *****************************************//
+//! @name STM Frame Parser
+//! The sensor frame is "<soil> [<field> ...] <temp>\r<type><checksum>\n".  It is
+//! parsed one byte at a time by ucSTM_ParseByte() as the receive ISRs finish
+//! each byte, so the values and the checksum verdict are ready when the line
+//! feed arrives.
+//! @{
+
+//! \def STM_PARSE_FIELDS
+//! \brief Receiving the space separated value fields
+#define STM_PARSE_FIELDS		0
+//! \def STM_PARSE_TYPE
+//! \brief The carriage return was seen, the next byte is the sensor type
+#define STM_PARSE_TYPE			1
+//! \def STM_PARSE_CHECKSUM
+//! \brief The next byte is the checksum
+#define STM_PARSE_CHECKSUM		2
+//! \def STM_PARSE_END
+//! \brief Waiting for the line feed
+#define STM_PARSE_END			3
+//! \def STM_PARSE_DONE
+//! \brief The frame is finished, m_cResult holds the verdict
+#define STM_PARSE_DONE			4
+
+//! \def STM_PARSE_SOIL_NEG
+//! \brief m_ucSign flag, the soil field had a minus sign
+#define STM_PARSE_SOIL_NEG		0x01
+//! \def STM_PARSE_TEMP_NEG
+//! \brief m_ucSign flag, the current field had a minus sign
+#define STM_PARSE_TEMP_NEG		0x02
+//! \def STM_PARSE_POINT
+//! \brief m_ucSign flag, the current field had a decimal point
+#define STM_PARSE_POINT			0x04
+//! \def STM_PARSE_DECIMAL
+//! \brief m_ucSign flag, the first digit behind the point was taken
+#define STM_PARSE_DECIMAL		0x08
+//! \def STM_PARSE_SOIL_TENTHS
+//! \brief m_ucSign flag, the soil field was sent with a decimal and is in tenths
+#define STM_PARSE_SOIL_TENTHS	0x10
+//! \def STM_PARSE_TEMP_TENTHS
+//! \brief m_ucSign flag, the current field was sent with a decimal and is in tenths
+#define STM_PARSE_TEMP_TENTHS	0x20
+
+//! \struct S_STM_Parser
+//! \brief Parse state of one channel
+typedef struct
+{
+	uint8 m_ucState;			//!< One of the STM_PARSE_ states
+	uint8 m_ucField;			//!< Number of the field being received, 0 is the soil field
+	uint8 m_ucSign;			//!< The STM_PARSE_ flags of the fields
+	uint8 m_ucCount;			//!< Bytes received, a frame longer than RX_BUFFER_SIZE_STM is dropped
+	uint8 m_ucSensorType;		//!< The byte after the carriage return
+	char m_cResult;			//!< 0, STM_ERROR_CODE_1 or STM_ERROR_CODE_2 (same codes as cSTM_Measure())
+	uint16 m_uiSum;			//!< Running sum of the bytes covered by the checksum
+	int32 m_lSoil;				//!< Soil moisture, decoded for the sensor type, see the STM Decoders
+	int16 m_nTemperature;		//!< Last field, decoded for the sensor type, see the STM Decoders
+	uint16 m_uiEdgeMsLeft;		//!< STM_DEADLINE_MS_LEFT() at the first start bit, 0 if none
+} S_STM_Parser;
+
+//! @name STM Decoders
+//! The digits of a field are read as they come, one digit behind the point
+//! is kept and more are dropped.  Once the frame is finished the fields are
+//! decoded for the sensor type:
+//! - MPS6 and unknown: fields in tenths, a field without a point is
+//!   multiplied by 10.  The MPS6 water potential is in kPa x10 and always
+//!   negative.
+//! - 5TM and 5TE: the DDI fields are plain integers and are kept as sent,
+//!   which is what the v1.20 REPORT_DATA has always carried.  The soil field
+//!   is the raw dielectric, the permittivity x STM_DDI_PERM_SCALE, and
+//!   uiSTM_SoilToVWC() turns it into the water content.  The last field is
+//!   the raw temperature, iSTM_DDITempToTenths() expands it above
+//!   STM_DDI_TEMP_KNEE and takes STM_DDI_TEMP_OFFSET off.
+//!
+//! The MPS6 temperature is the last field in degrees C x10.  The packed
+//! REPORT_DATA gives degrees C x10 and the water content for all of them.
+//! Multiplications by 10 are shifts and adds, the Topp equation is a table
+//! with linear steps, so a frame takes a bounded number of cycles.
+//! @{
+
+//! \def STM_DDI_PERM_SCALE
+//! \brief The 5TM and 5TE send the permittivity x50
+#define STM_DDI_PERM_SCALE		50
+
+//! \def STM_DDI_TEMP_OFFSET
+//! \brief The 5TM and 5TE send the temperature as degrees C x10 + STM_DDI_TEMP_OFFSET
+#define STM_DDI_TEMP_OFFSET		400
+
+//! \def STM_DDI_TEMP_KNEE
+//! \brief Raw temperatures above this are compressed by 5 and are expanded back
+#define STM_DDI_TEMP_KNEE		900
+
+//! \def STM_VWC_STEP_SHIFT
+//! \brief The Topp table has a point every 2^STM_VWC_STEP_SHIFT of the permittivity x10
+#define STM_VWC_STEP_SHIFT		6
+
+//! \def STM_VWC_POINTS
+//! \brief Points in the Topp table, covering a permittivity of 0 to 83.2
+#define STM_VWC_POINTS			14
+//! @}
+
+//! \var g_saSTM_Parser
+//! \brief Frame parser state of each channel, defined in STM_parse.c
+extern S_STM_Parser g_saSTM_Parser[NUM_STM_CHANNELS];
+//! @}
+
+//******************  STM Frame Events  *****************************************//
+//! @name STM Frame Events
+//! A read sleeps once, until the receive path raises STM_EVENT_FRAME or the
+//! TBCCR2 deadline raises STM_EVENT_TIMEOUT.  The deadline is counted in
+//! milliseconds from the end of the power up delay and is run in chunks of
+//! STM_DEADLINE_CHUNK_MS so it fits in the 16 bit timer.
+//! @{
+
+//! \def STM_EVENT_FRAME
+//! \brief g_ucSTM_Event flag, the frame (or every frame of a batch) is finished
+#define STM_EVENT_FRAME			0x01
+//! \def STM_EVENT_TIMEOUT
+//! \brief g_ucSTM_Event flag, the deadline passed
+#define STM_EVENT_TIMEOUT		0x02
+
+//! \def STM_TICKS_PER_MS
+//! \brief TimerB counts per millisecond, computed for 4MHz SMCLK
+#define STM_TICKS_PER_MS		4000
+//! \def STM_DEADLINE_CHUNK_MS
+//! \brief Longest part of a deadline armed on TBCCR2 in one go
+#define STM_DEADLINE_CHUNK_MS	16
+
+//! \def STM_POWER_UP_MS
+//! \brief Delay after exciting a sensor for the level shifter bug (at least 12.5 ms)
+#define STM_POWER_UP_MS			13
+
+//! \def STM_TIMEOUT_MS_5TM
+//! \brief Deadline for a 5TM frame, response delay plus about 14 bytes at 1200 baud
+#define STM_TIMEOUT_MS_5TM		350
+//! \def STM_TIMEOUT_MS_5TE
+//! \brief Deadline for a 5TE frame, it carries one more field than the 5TM
+#define STM_TIMEOUT_MS_5TE		400
+//! \def STM_TIMEOUT_MS_MPS6
+//! \brief Deadline for an MPS6 frame
+#define STM_TIMEOUT_MS_MPS6		400
+//! \def STM_TIMEOUT_MS_DEFAULT
+//! \brief Deadline while the sensor type is not known, a full RX_BUFFER_SIZE_STM frame fits
+#define STM_TIMEOUT_MS_DEFAULT	500
+
+//! \def STM_DEADLINE_MS_LEFT
+//! \brief Milliseconds left of the deadline, from TIMERB1_ISR or PORT1_ISR
+//!
+//! The ticks left of the armed chunk are divided by 4096 instead of
+//! STM_TICKS_PER_MS, which is close enough and costs a shift.
+#define STM_DEADLINE_MS_LEFT()	(g_uiSTM_DeadlineMsLeft + ((uint16) (TBCCR2 - TBR) >> 12))
+//! @}
+
+//******************  STM Timing Profiles  *****************************************//
+//! @name STM Timing Profiles
+//! Each sensor type has a profile holding the latency from the excite to the
+//! first start bit, learned from the reads and kept in the config store.
+//! Once it is known the RX window opens STM_RX_GUARD_MS before the frame is
+//! due and closes once a full frame would be in.  A read that fails puts
+//! only its own channel on the full timeout, its bit in g_ucSTM_LatencyMiss,
+//! until it reads a good frame again.  The learned profile and the stored
+//! latency are kept.
+//! @{
+
+//! \def STM_NUM_PROFILES
+//! \brief One profile each for the 5TM, the 5TE and the MPS6
+#define STM_NUM_PROFILES		3
+
+//! \def STM_RX_GUARD_MS
+//! \brief The RX window opens this long before the learned first start bit
+#define STM_RX_GUARD_MS			16
+
+//! \def STM_FRAME_MS
+//! \brief Longest frame, a byte takes about 8.3 ms at 1200 baud
+#define STM_FRAME_MS			(RX_BUFFER_SIZE_STM * 9)
+
+//! \def STM_LATENCY_SLACK_MS
+//! \brief Drift of a learned latency before it is written to the config store again
+#define STM_LATENCY_SLACK_MS	8
+//! @}
+
+//******************  STM Bursts  *****************************************//
+//! @name STM Bursts
+//! A channel can be read several times per measurement.  The sensors send a
+//! single frame per excite, so the frames of a burst are separate excite
+//! cycles STM_BURST_REST_MS apart, but the CP sees one measurement.  Frames
+//! that fail the checksum or time out are dropped, the median of the good
+//! ones is reported with the spread, see uiSTM_GetSpread().
+//! @{
+
+//! \def STM_BURST_MAX
+//! \brief Most frames in a burst
+#define STM_BURST_MAX			5
+
+//! \def STM_BURST_REST_MS
+//! \brief Time a sensor is left off between the frames of a burst
+#define STM_BURST_REST_MS		20
+
+//! \struct S_STM_Burst
+//! \brief The good frames of a burst on one channel
+typedef struct
+{
+	int32 m_laSoil[STM_BURST_MAX];			//!< Soil moisture of the good frames
+	int16 m_naTemperature[STM_BURST_MAX];	//!< Temperature of the good frames
+	uint8 m_ucGood;							//!< Good frames so far
+	char m_cResult;							//!< Code of the last failed frame, 0 if none
+} S_STM_Burst;
+//! @}
+
+//******************  STM Sample Durations  *********************************//
+//! @name STM Sample Durations
+//! The time of every measurement with a good result, from the excite to the
+//! result with bursts, rests and retries, is taken on the diagnostics clock
+//! and smoothed per channel.  A new sensor type starts the average over.
+//! Without DIAG_ENABLED nothing is measured.
+//! @{
+
+//! \def STM_DURATION_SHIFT
+//! \brief A new measurement weighs 1 / 2^STM_DURATION_SHIFT in the average
+#define STM_DURATION_SHIFT		2
+//! @}
+
+//******************  STM Health  *****************************************//
+//! @name STM Health
+//! A measurement without a good frame is retried locally before it is
+//! reported, and every channel keeps a count of its failed measurements.  A
+//! channel with a dead or missing sensor is skipped for a growing number of
+//! measurements instead of waiting out its deadline on every sweep.
+//! @{
+
+//! \def STM_RETRIES
+//! \brief Most retries of a measurement, the first rests 2 * STM_BURST_REST_MS
+#define STM_RETRIES				2
+
+//! \def STM_RETRY_BUDGET_MS
+//! \brief A retry is only started if the measurement stays within this, the sample duration
+//!
+//! A read and a retry with the full window of an unknown type fit, so a
+//! channel that has missed its learned window still gets one retry.
+#define STM_RETRY_BUDGET_MS		(2 * (STM_POWER_UP_MS + STM_TIMEOUT_MS_DEFAULT) + (STM_BURST_REST_MS << 1))
+
+//! \def STM_HEALTH_FAIL_LIMIT
+//! \brief Failed measurements in a row before a channel is skipped and no longer retried
+#define STM_HEALTH_FAIL_LIMIT	3
+
+//! \def STM_HEALTH_SKIP_SHIFT
+//! \brief A failing channel skips at most 2^STM_HEALTH_SKIP_SHIFT measurements between probes
+#define STM_HEALTH_SKIP_SHIFT	4
+
+//! \def STM_HEALTH_LENGTH
+//! \brief Length of the health table, see ucSTM_FetchHealth()
+#define STM_HEALTH_LENGTH		(6 * NUM_STM_CHANNELS)
+
+//! \struct S_STM_Health
+//! \brief The health of one channel
+typedef struct
+{
+	uint8 m_ucFailRun;			//!< Failed measurements in a row, stops at 0xFF
+	uint8 m_ucSkip;				//!< Measurements still to skip
+	uint16 m_uiFailures;		//!< Failed measurements since the reset, stops at 0xFFFF
+	uint16 m_uiRetries;			//!< Retries since the reset, stops at 0xFFFF
+} S_STM_Health;
+//! @}
+
 //! \def STM_ERROR_CODE_1
 //! \brief The Checksum didn't work out...
 #define STM_ERROR_CODE_1		0x01
@@ -97,19 +438,43 @@
 //! \brief Timed out without a response
 #define STM_ERROR_CODE_2		0x02
 
+//! \def STM_ERROR_CODE_3
+//! \brief Not excited, the supply may brown out (see ucPWR_SupplyLow())
+#define STM_ERROR_CODE_3		0x03
+
+//! \def STM_ERROR_CODE_4
+//! \brief Not excited, the channel is skipped after failing STM_HEALTH_FAIL_LIMIT times in a row
+#define STM_ERROR_CODE_4		0x04
+
 
 void vSTM_Initialize(void);
 char cSTM_Measure(uint8 ucChannel);
 
 void vSTM_Display(char);
-char cSTM_Test_Checksum(void);
-void cSTM_ReadValue(void);
+void vSTM_ParseReset(uint8 ucChannelIdx);
+void vSTM_StartDeadline(uint16 uiMs);
+uint8 ucSTM_WaitForEvent(void);
+uint16 uiSTM_GetTimeoutMs(uint8 ucSensorType);
+uint8 ucSTM_GetProfileIdx(uint8 ucSensorType);
+uint16 uiSTM_GetRetryRestMs(uint16 uiSpentMs, uint8 ucRetry, uint16 uiReadMs);
+uint8 ucSTM_ParseByte(uint8 ucChannelIdx, uint8 ucByte);
+uint16 uiSTM_SoilToVWC(int32 lSoil);
+int16 iSTM_DDITempToTenths(int16 iRaw);
+
+void vSTM_MeasureBatch(uint8 ucChannelMask);
 
 uint8 cSTM_RequestSensorType(uint8 ucChannel);
 uint8 cSTM_ReturnSensorType(uint8 ucChannel);
+uint8 ucSTM_GetTypeGen(void);
+void vSTM_LoadSensorTypes(void);
+uint8 ucSTM_SetBurst(uint8 ucChannel, uint8 ucFrames);
+uint8 ucSTM_GetBurst(uint8 ucChannel);
+uint8 ucSTM_FetchHealth(uint8 *pucBuff);
+uint16 uiSTM_GetDurationMs(uint8 ucChannel);
 
 signed long lSTM_GetSoil(void);
 signed int iSTM_GetTemp(void);
+uint16 uiSTM_GetSpread(void);
 
 //!Interrupt Handler
 __interrupt void TIMERB1_ISR(void);
@@ -0,0 +1,348 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file STM_parse.c
+//! \brief The STM frame parser
+//!
+//! The parser and the sensor tables touch no registers, so this file builds
+//! apart from the MSP430 and can be fed recorded frames off target.
+//!
+//! @addtogroup
+//! @{
+//!
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../core/core.h"
+
+//! \var g_saSTM_Parser
+//! \brief Frame parser state of each channel, fed by TIMERB1_ISR
+S_STM_Parser g_saSTM_Parser[NUM_STM_CHANNELS];
+
+//! \var g_uiaSTM_Topp
+//! \brief Volumetric water content in 0.1 % at every STM_VWC_STEP_SHIFT step of the permittivity x10
+//!
+//! VWC = 4.3e-6 e^3 - 5.5e-4 e^2 + 2.92e-2 e - 5.3e-2, clamped at 0.
+static const uint16 g_uiaSTM_Topp[STM_VWC_POINTS] = { 0, 112, 240, 335, 406, 459, 501, 538, 577, 626, 690, 777, 893, 1046 };
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the frame deadline for a sensor type
+//!
+//!   \param ucSensorType, FIVETM, FIVETE, MPS6 or anything else for unknown
+//!   \return The deadline in milliseconds
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiSTM_GetTimeoutMs(uint8 ucSensorType)
+{
+	switch (ucSensorType)
+	{
+		case FIVETM:
+			return STM_TIMEOUT_MS_5TM;
+
+		case FIVETE:
+			return STM_TIMEOUT_MS_5TE;
+
+		case MPS6:
+			return STM_TIMEOUT_MS_MPS6;
+
+		default:
+			return STM_TIMEOUT_MS_DEFAULT;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the timing profile of a sensor type
+//!
+//!   \param ucSensorType, FIVETM, FIVETE, MPS6 or anything else for unknown
+//!   \return The profile index, STM_NUM_PROFILES for an unknown type
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_GetProfileIdx(uint8 ucSensorType)
+{
+	switch (ucSensorType)
+	{
+		case FIVETM:
+			return 0;
+
+		case FIVETE:
+			return 1;
+
+		case MPS6:
+			return 2;
+
+		default:
+			return STM_NUM_PROFILES;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the rest before a retry if the retry fits the budget
+//!
+//!   The rest doubles with every retry, the first is 2 * STM_BURST_REST_MS.
+//!
+//!   \param uiSpentMs, the time the measurement has taken so far
+//!   \param ucRetry, 0 for the first retry
+//!   \param uiReadMs, how long the retry reads
+//!   \return The rest in milliseconds, 0 if the retry would end past STM_RETRY_BUDGET_MS
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiSTM_GetRetryRestMs(uint16 uiSpentMs, uint8 ucRetry, uint16 uiReadMs)
+{
+	uint16 uiRestMs;
+
+	uiRestMs = STM_BURST_REST_MS << (ucRetry + 1);
+	if ((uiSpentMs + uiRestMs + uiReadMs) > STM_RETRY_BUDGET_MS)
+		return 0;
+
+	return uiRestMs;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the volumetric water content for a permittivity
+//!
+//!   \param uiPermittivity, the dielectric permittivity x10
+//!   \return The volumetric water content in 0.1 %
+///////////////////////////////////////////////////////////////////////////////
+static uint16 uiSTM_GetVWC(uint16 uiPermittivity)
+{
+	uint8 ucIdx;
+	uint8 ucStep;
+
+	if (uiPermittivity >= ((STM_VWC_POINTS - 1) << STM_VWC_STEP_SHIFT))
+		return g_uiaSTM_Topp[STM_VWC_POINTS - 1];
+
+	ucIdx = uiPermittivity >> STM_VWC_STEP_SHIFT;
+	ucStep = uiPermittivity & ((1 << STM_VWC_STEP_SHIFT) - 1);
+
+	// One 16 x 16 multiply between the points
+	return g_uiaSTM_Topp[ucIdx] + (((g_uiaSTM_Topp[ucIdx + 1] - g_uiaSTM_Topp[ucIdx]) * ucStep) >> STM_VWC_STEP_SHIFT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the volumetric water content of a 5TM or 5TE soil value
+//!
+//!   \param lSoil, the raw dielectric as sent, see the STM Decoders
+//!   \return The volumetric water content in 0.1 %
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiSTM_SoilToVWC(int32 lSoil)
+{
+	if (lSoil <= 0)
+		return 0;
+
+	if (lSoil > 0x7FFF)
+		lSoil = 0x7FFF;
+
+	// The permittivity x10
+	return uiSTM_GetVWC((uint16) lSoil / (STM_DDI_PERM_SCALE / 10));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Returns the temperature of a 5TM or 5TE in degrees C x10
+//!
+//!   \param iRaw, the raw temperature as sent, see the STM Decoders
+//!   \return The temperature in degrees C x10
+///////////////////////////////////////////////////////////////////////////////
+int16 iSTM_DDITempToTenths(int16 iRaw)
+{
+	if (iRaw > STM_DDI_TEMP_KNEE)
+	{
+		// x5 as (x << 2) + x
+		iRaw -= STM_DDI_TEMP_KNEE;
+		iRaw = STM_DDI_TEMP_KNEE + (iRaw << 2) + iRaw;
+	}
+
+	return iRaw - STM_DDI_TEMP_OFFSET;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Notes whether the field being received was sent in tenths
+//!
+//!   The sensor type comes after the fields, so the scaling is left to
+//!   vSTM_Decode().
+//!
+//!   \param pParser, the parser of the channel
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vSTM_CloseField(S_STM_Parser *pParser)
+{
+	if (pParser->m_ucSign & STM_PARSE_DECIMAL)
+	{
+		pParser->m_ucSign |= STM_PARSE_TEMP_TENTHS;
+		if (pParser->m_ucField == 0)
+			pParser->m_ucSign |= STM_PARSE_SOIL_TENTHS;
+	}
+
+	pParser->m_ucSign &= ~(STM_PARSE_POINT | STM_PARSE_DECIMAL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Turns the fields into the units of the sensor type
+//!
+//!   The signs have been applied, see the STM Decoders.
+//!
+//!   \param pParser, the parser of the channel
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vSTM_Decode(S_STM_Parser *pParser)
+{
+	switch (pParser->m_ucSensorType)
+	{
+		case FIVETM:
+		case FIVETE:
+			// Plain integers, both fields go out as sent
+		return;
+
+		case MPS6:
+			// The water potential is always a suction
+			if (pParser->m_lSoil > 0)
+				pParser->m_lSoil = -pParser->m_lSoil;
+		break;
+
+		default:
+		break;
+	}
+
+	// x10 as (x << 3) + (x << 1)
+	if (!(pParser->m_ucSign & STM_PARSE_SOIL_TENTHS))
+		pParser->m_lSoil = (pParser->m_lSoil << 3) + (pParser->m_lSoil << 1);
+	if (!(pParser->m_ucSign & STM_PARSE_TEMP_TENTHS))
+		pParser->m_nTemperature = (pParser->m_nTemperature << 3) + (pParser->m_nTemperature << 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!   \brief Readies the frame parser of a channel for a new frame
+//!
+//!   \param ucChannelIdx, 0 = STM1
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSTM_ParseReset(uint8 ucChannelIdx)
+{
+	S_STM_Parser *pParser;
+
+	pParser = &g_saSTM_Parser[ucChannelIdx];
+	pParser->m_ucState = STM_PARSE_FIELDS;
+	pParser->m_ucField = 0;
+	pParser->m_ucSign = 0;
+	pParser->m_ucCount = 0;
+	pParser->m_ucSensorType = 0;
+	pParser->m_cResult = STM_ERROR_CODE_2; // Nothing yet, same as a time out
+	pParser->m_uiSum = 0;
+	pParser->m_lSoil = 0;
+	pParser->m_nTemperature = 0;
+	pParser->m_uiEdgeMsLeft = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Feeds one received byte to the frame parser of a channel
+//!
+//!  Called from TIMERB1_ISR at the stop bit of every byte.  The first field is the
+//!  soil moisture and the last field before the carriage return is the temperature
+//!  for all of the supported sensors.  Digits are accumulated with shifts and adds
+//!  as they arrive and a minus sign negates its field.  See the STM Decoders for
+//!  the units.
+//!  The checksum is (sum of the bytes up to and including the sensor type % 64) + 32.
+//!
+//! z = 5TE
+//! x = 5TM
+//! l = MPS6
+//!
+//!   \param ucChannelIdx, 0 = STM1
+//!   \param ucByte, the received byte
+//!   \return 1 when the frame is finished (good or bad), 0 otherwise
+///////////////////////////////////////////////////////////////////////////////////////////////
+uint8 ucSTM_ParseByte(uint8 ucChannelIdx, uint8 ucByte)
+{
+	S_STM_Parser *pParser;
+	uint8 ucDigit;
+
+	pParser = &g_saSTM_Parser[ucChannelIdx];
+
+	// Ignore anything after the end of the frame
+	if (pParser->m_ucState == STM_PARSE_DONE)
+		return 1;
+
+	// A frame that runs on without a line feed is garbage
+	if (++pParser->m_ucCount > RX_BUFFER_SIZE_STM)
+	{
+		pParser->m_cResult = STM_ERROR_CODE_1;
+		pParser->m_ucState = STM_PARSE_DONE;
+		return 1;
+	}
+
+	switch (pParser->m_ucState)
+	{
+		case STM_PARSE_FIELDS:
+			pParser->m_uiSum += ucByte;
+
+			if (ucByte == 0x0D)
+			{
+				vSTM_CloseField(pParser);
+				pParser->m_ucState = STM_PARSE_TYPE;
+			}
+			else if (ucByte == 0x20) //0x20 is a " "
+			{
+				// Start a new field, the temperature is whatever field comes last
+				vSTM_CloseField(pParser);
+				pParser->m_ucField++;
+				pParser->m_ucSign &= ~(STM_PARSE_TEMP_NEG | STM_PARSE_TEMP_TENTHS);
+				pParser->m_nTemperature = 0;
+			}
+			else if (ucByte == 0x2D) //0x2D is a "-"
+			{
+				pParser->m_ucSign |= STM_PARSE_TEMP_NEG;
+				if (pParser->m_ucField == 0)
+					pParser->m_ucSign |= STM_PARSE_SOIL_NEG;
+			}
+			else if (ucByte == 0x2E) //0x2E is a "."
+			{
+				pParser->m_ucSign |= STM_PARSE_POINT;
+			}
+			else
+			{
+				// Anything else that is not a digit is skipped, and so are the digits past the first decimal
+				ucDigit = ucByte - 48;
+				if ((ucDigit > 9) || (pParser->m_ucSign & STM_PARSE_DECIMAL))
+					break;
+
+				if (pParser->m_ucSign & STM_PARSE_POINT)
+					pParser->m_ucSign |= STM_PARSE_DECIMAL;
+
+				// x10 as (x << 3) + (x << 1)
+				pParser->m_nTemperature = (pParser->m_nTemperature << 3) + (pParser->m_nTemperature << 1) + ucDigit;
+				if (pParser->m_ucField == 0)
+					pParser->m_lSoil = (pParser->m_lSoil << 3) + (pParser->m_lSoil << 1) + ucDigit;
+			}
+		break;
+
+		case STM_PARSE_TYPE:
+			pParser->m_uiSum += ucByte;
+			pParser->m_ucSensorType = ucByte;
+			pParser->m_ucState = STM_PARSE_CHECKSUM;
+		break;
+
+		case STM_PARSE_CHECKSUM:
+			if (ucByte == ((pParser->m_uiSum & 0x3F) + 32))
+				pParser->m_cResult = 0;
+			else
+				pParser->m_cResult = STM_ERROR_CODE_1;
+			pParser->m_ucState = STM_PARSE_END;
+		break;
+
+		case STM_PARSE_END:
+			if (ucByte != 0x0A)
+				pParser->m_cResult = STM_ERROR_CODE_1;
+
+			if (pParser->m_ucSign & STM_PARSE_TEMP_NEG)
+				pParser->m_nTemperature = -pParser->m_nTemperature;
+
+			if (pParser->m_ucSign & STM_PARSE_SOIL_NEG)
+				pParser->m_lSoil = -pParser->m_lSoil;
+
+			vSTM_Decode(pParser);
+
+			pParser->m_ucState = STM_PARSE_DONE;
+		return 1;
+
+		default:
+		break;
+	}
+
+	return 0;
+}
+
+//! @}
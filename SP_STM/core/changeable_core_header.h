@@ -89,17 +89,41 @@
 #define		CoreP6SEL	0x00
 //!@}
 
+//! @name Background Sampling
+//! The transducers can be sampled on their own schedule so that REQUEST_DATA
+//! is answered from S_Report without waiting for the sensors.  Each sampled
+//! transducer has a scheduler timer, the SP sleeps in LPM3 between ticks.
+//! @{
+//! \def SCHED_EVT_SAMPLE
+//! \brief Scheduler event posted by the timers of the sampled transducers
+#define SCHED_EVT_SAMPLE		0
+
+//! \def NUM_SAMPLED_TRANSDUCERS
+//! \brief The number of transducers that can be scheduled, transducer 1 is index 0 and scheduler timer 0
+#define NUM_SAMPLED_TRANSDUCERS	4
+
+//! \def SCHED_SAMPLE_TIMERS
+//! \brief The mask of the scheduler timers of the sampled transducers
+#define SCHED_SAMPLE_TIMERS		((1 << NUM_SAMPLED_TRANSDUCERS) - 1)
+//!@}
+
 // Functions visible to the core.  Adding these functions makes the core scalable to any application
 // since the core does not need to know anything about the specifics of the application layer.
 uint8 ucMain_FetchData(volatile uint8 * pBuff);
+uint8 ucMain_FetchPackedData(volatile uint8 * pucBuff, uint8 ucReqVersion);
 void vMain_FetchLabel(uint8 ucTransNum, volatile uint8 * pucArr);
 uint16 uiMainDispatch(uint8 ucCmdTransNum, uint8 ucCmdParamLen, uint8 *ucParam);
+void vMain_ApplyParams(uint8 ucCmdTransNum, uint8 ucCmdParamLen, uint8 *ucParam);
+void vMain_PrepareDispatch(uint16 uiTransducerMask);
 uint8 ucMAIN_ReturnSensorType(uint8 ucSensorCount);
 void vMAIN_RequestSensorType(uint8 ucChannel);
 uint8 ucMain_getNumTransducers(void);
 uint8 ucMain_getSampleDuration(uint8 ucTransNum);
 uint8 ucMain_getTransducerType(uint8 ucTransNum);
-void vMain_EventTrigger(void);
+uint8 ucMain_SetSampleInterval(uint8 ucTransNum, uint16 uiSeconds);
+uint8 ucMain_SetThreshold(uint8 ucTransNum, int16 iThreshold, uint16 uiHysteresis);
 uint8 ucMain_ShutdownAllowed(void);
+uint8 ucMain_FetchHealth(uint8 *pucBuff);
+uint8 ucMain_FetchDescribeFrame(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast);
 #endif /* CHANGEABLE_CORE_HEADER_H_ */
 
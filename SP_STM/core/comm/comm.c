@@ -59,6 +59,8 @@ uint16 g_unCOMM_BaudRateDelayControl;
 //! @{
 //! \var volatile uint8 g_ucaRXBuffer[MAXMSGLEN]
 //! \brief The software UART RX Buffer
+//!
+//! The core handles the message in place, see ucCOMM_CheckMessage().
 volatile uint8 g_ucaRXBuffer[MAXMSGLEN];
 
 //! \var volatile uint8 g_ucRXBufferIndex
@@ -72,10 +74,33 @@ uint8 g_ucRXBitsLeft;
 //! \var uint8 g_ucRXParityBit
 //! \brief Even Parity for bit banging uart
 uint8 ucRXParityBit;
+
+//! \var uint8 g_ucaCOMM_RXCRC[CRC_SZ]
+//! \brief Running CRC16 of g_ucaRXBuffer, updated as each byte is received
+//!
+//! Restarted when the first byte of a message lands.  Once the CRC bytes are
+//! in the register reads zero for a good message.
+uint8 g_ucaCOMM_RXCRC[CRC_SZ];
+//! @}
+
+//******************  TX Variables  *****************************************//
+//! @name Transmit Variables
+//! @{
+//! \var uint8 g_ucaCOMM_TXCRC[CRC_SZ]
+//! \brief Running CRC16 of the message being sent, updated as each byte is acked
+uint8 g_ucaCOMM_TXCRC[CRC_SZ];
+
+//! \var uint8 g_ucaCOMM_Reply[MAXMSGLEN]
+//! \brief The other half of g_ucaRXBuffer, the core builds its replies here
+//!
+//! The request stays readable while the reply is built, so neither is copied.
+uint8 g_ucaCOMM_Reply[MAXMSGLEN];
 //! @}
 
 
 //******************  Functions  ********************************************//
+// The bit banged link is replaced by comm_usci.c when COMM_USE_USCI is set
+#if !COMM_USE_USCI
 ///////////////////////////////////////////////////////////////////////////////
 //! \brief This sets up the hardware resources for doing software UART
 //!
@@ -144,8 +169,8 @@ uint8 ucCOMM_WaitForStartCondition(void)
 	P_SDA_IFG &= ~SDA_PIN;
 	P_SDA_IE |= SDA_PIN;
 
-	// Wait in deep sleep
-	LPM3;
+	// Wait in deep sleep, LPM4 if the sampling clock is off
+	vPWR_Sleep();
 
 	// Disable interrupts on the SDA line
 	P_SDA_IE &= ~SDA_PIN;
@@ -190,6 +215,7 @@ uint8 ucCOMM_SendByte(uint8 ucTXChar)
 	uint16 uiTXChar;
 	uint8 ucSDABit;
 	uint8 ucSCLBit;
+	uint8 ucaCRC[CRC_SZ];
 
 	// If we are already busy, return
 	if (g_ucCOMM_Flags & COMM_TX_BUSY)
@@ -246,6 +272,11 @@ uint8 ucCOMM_SendByte(uint8 ucTXChar)
 	// Switch clock edge interrupt
 	P_SCL_IES &= ~ucSCLBit;
 
+	// Run the CRC while the CP clocks the ack bit, it is only kept if the byte is acked
+	ucaCRC[CRC16_HI] = g_ucaCOMM_TXCRC[CRC16_HI];
+	ucaCRC[CRC16_LO] = g_ucaCOMM_TXCRC[CRC16_LO];
+	CRC16_UPDATE_BYTE(ucTXChar, ucaCRC);
+
 	// Wait for the next rising clock
 	while (!(P_SCL_IFG & ucSCLBit));
 	P_SCL_IFG &= ~ucSCLBit;
@@ -264,8 +295,11 @@ uint8 ucCOMM_SendByte(uint8 ucTXChar)
 
 	if (ucAck == 1)
 		return COMM_ACK_ERR;
-	else
-		return COMM_OK;
+
+	g_ucaCOMM_TXCRC[CRC16_HI] = ucaCRC[CRC16_HI];
+	g_ucaCOMM_TXCRC[CRC16_LO] = ucaCRC[CRC16_LO];
+
+	return COMM_OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -353,6 +387,11 @@ uint8 ucCOMM_ReceiveByte(void)
 	// Next bit is ack so switch the direction of the SDA pin
 	P_SDA_DIR |= SDA_PIN;
 
+	// Fold the byte into the running CRC while the CP clocks the ack bit
+	if (g_ucRXBufferIndex == 0)
+		CRC16_INIT(g_ucaCOMM_RXCRC);
+	CRC16_UPDATE_BYTE(ucRXByte, g_ucaCOMM_RXCRC);
+
 	// Wait for the next falling clock clock
 	while (!(P_SCL_IFG & SCL_PIN));
 	P_SCL_IFG &= ~SCL_PIN;
@@ -363,8 +402,10 @@ uint8 ucCOMM_ReceiveByte(void)
 	g_ucCOMM_Flags &= ~COMM_RX_BUSY;
 
 	// Set the parity error flag
-	if (ucParityBit != ucRxParityBit)
+	if (ucParityBit != ucRxParityBit) {
 		g_ucCOMM_Flags |= COMM_PARITY_ERR;
+		DIAG_COUNT(DIAG_CNT_COMM_PARITY);
+	}
 
 	g_ucaRXBuffer[g_ucRXBufferIndex] = ucRXByte;
 	g_ucRXBufferIndex++; // Increment index for next byte
@@ -442,7 +483,10 @@ uint8 ucRXMessageSize;
 //! \brief Sends a data message on the serial port
 //!
 //! This function sends the data message pointed to by \e p_DataMessage on the
-//! software UART line
+//! software UART line.  The CRC is built up by ucCOMM_SendByte() as the
+//! payload goes out and is stuffed behind it, so there is no pass over the
+//! message before the first byte is sent.  \e pBuff must have room for the
+//! two CRC bytes.
 //!   \param p_DataMessage Pointer to the message to send
 //!   \return None
 ///////////////////////////////////////////////////////////////////////////////.
@@ -451,22 +495,28 @@ void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength)
 	uint8 ucLoopCount;
 	uint8 ucErrorCount;
 
+	DIAG_BEGIN(DIAG_PHASE_COMM_SEND);
+
 	// Clear error count
 	ucErrorCount = 0;
 
-	// add the CRC bytes to the length
-	ucLength += CRC_SZ;
+	// Start the running CRC
+	CRC16_INIT(g_ucaCOMM_TXCRC);
 
-	// Compute the CRC of the message
-	ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_SEND, pBuff, ucLength);
+	for (ucLoopCount = 0x00; ucLoopCount < (ucLength + CRC_SZ); ucLoopCount++) {
 
-	for (ucLoopCount = 0x00; ucLoopCount < ucLength; ucLoopCount++) {
+		// The CRC is complete once the payload is out, stuff it behind the payload
+		if (ucLoopCount == ucLength) {
+			pBuff[ucLength] = g_ucaCOMM_TXCRC[CRC16_HI];
+			pBuff[ucLength + 1] = g_ucaCOMM_TXCRC[CRC16_LO];
+		}
 
 		// Attempt to send a byte
-		if (ucCOMM_SendByte(*pBuff++) != COMM_OK) {
+		if (ucCOMM_SendByte(pBuff[ucLoopCount]) != COMM_OK) {
 
 			// If there is an error then increment the error count
 			ucErrorCount++;
+			DIAG_COUNT(DIAG_CNT_COMM_RETRY);
 
 			// Decrement the loop count to attempt to resend the byte
 			ucLoopCount--;
@@ -476,23 +526,171 @@ void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength)
 				break;
 		}
 	}
+
+	DIAG_END(DIAG_PHASE_COMM_SEND);
+}
+
+#if COMM_SEGMENTED_ENABLED
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sends a byte of a segmented transfer and adds it to the window CRC
+//!
+//! The ack bit is not checked, the window CRC covers the byte.
+//!   \param ucByte The byte
+//!   \param pucCRC The CRC of the window
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+static void vCOMM_SendSegByte(uint8 ucByte, uint8 *pucCRC)
+{
+	ucCOMM_SendByte(ucByte);
+	CRC16_UPDATE_BYTE(ucByte, pucCRC);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//! \brief Grabs the raw chars from buffer and formats into a data message
+//! \brief Sends a bulk reply as a segmented transfer
+//!
+//! The frames are filled one at a time by \e pfnFill, which moves the cursor
+//! on and sets *pucLast on the last frame.  A window that is not acked is
+//! filled again from the cursor it started with.  The format is described
+//! with MSG_SEG_WINDOW.
 //!
-//! This function takes the characters from \e g_ucaRXBuffer and
-//! stores them in the data message pointed to by \e message.
-//!   \param message Pointer to the message
+//! The frames are filled into g_ucaCOMM_Reply, which is idle for the
+//! transfer, so the payload is not on the stack.
+//!   \param ucType The message type of the header
+//!   \param ucFlags The flags of the header
+//!   \param pfnFill Fills a frame payload of up to MSG_SEG_MAX_PAYLOAD bytes, returns its length
+//!   \param uiCursor Where \e pfnFill starts
+//!   \return COMM_OK, or COMM_ERROR if a window failed MSG_SEG_TRIES times
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucCOMM_SendSegmented(uint8 ucType, uint8 ucFlags, uint8 (*pfnFill)(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast), uint16 uiCursor)
+{
+	uint8 ucaCRC[CRC_SZ];
+	uint16 uiWindowCursor;
+	uint8 ucSeq;
+	uint8 ucWindowSeq;
+	uint8 ucFrame;
+	uint8 ucLength;
+	uint8 ucLast;
+	uint8 ucTries;
+	uint8 ucIdx;
+	uint8 ucAck;
+
+	DIAG_BEGIN(DIAG_PHASE_COMM_SEND);
+
+	ucSeq = 0;
+	ucTries = 0;
+
+	while (1) {
+		// Remember where the window starts in case it has to be sent again
+		uiWindowCursor = uiCursor;
+		ucWindowSeq = ucSeq;
+		ucLast = 0;
+
+		CRC16_INIT(ucaCRC);
+
+		if (ucSeq == 0) {
+			vCOMM_SendSegByte(ucType, ucaCRC);
+			vCOMM_SendSegByte(SP_HEADERSIZE, ucaCRC);
+			vCOMM_SendSegByte(SP_SEGMENTED_VERSION, ucaCRC);
+			vCOMM_SendSegByte(ucFlags, ucaCRC);
+		}
+
+		for (ucFrame = 0; (ucFrame < MSG_SEG_WINDOW) && !ucLast; ucFrame++) {
+			ucLength = pfnFill(&uiCursor, g_ucaCOMM_Reply, &ucLast);
+
+			vCOMM_SendSegByte(ucLast ? (ucSeq | MSG_SEG_LAST) : ucSeq, ucaCRC);
+			vCOMM_SendSegByte(ucLength, ucaCRC);
+			for (ucIdx = 0; ucIdx < ucLength; ucIdx++)
+				vCOMM_SendSegByte(g_ucaCOMM_Reply[ucIdx], ucaCRC);
+
+			ucSeq = (ucSeq + 1) & ~MSG_SEG_LAST;
+		}
+
+		ucCOMM_SendByte(ucaCRC[CRC16_HI]);
+		ucCOMM_SendByte(ucaCRC[CRC16_LO]);
+
+		// One byte from the CP acks the whole window
+		g_ucCOMM_Flags &= ~COMM_PARITY_ERR;
+		g_ucRXBufferIndex = 0;
+		ucAck = 0;
+		if ((ucCOMM_ReceiveByte() == COMM_OK) && !(g_ucCOMM_Flags & COMM_PARITY_ERR))
+			ucAck = g_ucaRXBuffer[0];
+		g_ucRXBufferIndex = 0;
+
+		if (ucAck == MSG_SEG_ACK) {
+			ucTries = 0;
+			if (ucLast)
+				break;
+		}
+		else {
+			DIAG_COUNT(DIAG_CNT_COMM_RETRY);
+
+			if (++ucTries == MSG_SEG_TRIES) {
+				DIAG_END(DIAG_PHASE_COMM_SEND);
+				return COMM_ERROR;
+			}
+
+			uiCursor = uiWindowCursor;
+			ucSeq = ucWindowSeq;
+		}
+	}
+
+	DIAG_END(DIAG_PHASE_COMM_SEND);
+
+	return COMM_OK;
+}
+#endif // COMM_SEGMENTED_ENABLED
+
+#endif // !COMM_USE_USCI
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Drives INT_PIN high to tell the CP that a report is waiting
+//!
+//! The CP leaves the line undriven while it waits for a CMD_REPORT_BIT
+//! command, and all the time once it has asked for INT_NOTIFY_BIT.  The wake
+//! up interrupt of the pin is off until vCOMM_ReleaseInt().
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+void vCOMM_RaiseInt(void)
+{
+	P_INT_IE &= ~INT_PIN;
+	P_INT_OUT |= INT_PIN;
+	P_INT_DIR |= INT_PIN;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Hands INT_PIN back to the CP as the wake up line
+//!
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+void vCOMM_ReleaseInt(void)
+{
+	P_INT_DIR &= ~INT_PIN;
+	P_INT_OUT &= ~INT_PIN;
+	P_INT_IFG &= ~INT_PIN;
+	P_INT_IE |= INT_PIN;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Checks the message received in g_ucaRXBuffer
+//!
+//! The message is not copied out, the caller handles it in place and builds
+//! the reply in g_ucaCOMM_Reply.  It stays valid until the next byte is
+//! received.
 //!   \return The error code indicating the status after call
 //!   \sa comm.h msg.h
 ///////////////////////////////////////////////////////////////////////////////
-uint8 ucCOMM_GrabMessageFromBuffer(volatile uint8 * pucBuff)
+uint8 ucCOMM_CheckMessage(void)
 {
-	uint8 ucLoopCount;
+	uint8 ucIndex;
 	uint8 ucLength;
 
-	if (g_ucRXBufferIndex < SP_HEADERSIZE)
+	// The next message is received from the start of the buffer
+	ucIndex = g_ucRXBufferIndex;
+	g_ucRXBufferIndex = 0x00;
+
+	if (ucIndex < SP_HEADERSIZE)
 		return COMM_BUFFER_UNDERFLOW;
 
 	// Read the length of the message
@@ -502,16 +700,10 @@ uint8 ucCOMM_GrabMessageFromBuffer(volatile uint8 * pucBuff)
 	if (ucLength > MAXMSGLEN)
 		return COMM_BUFFER_UNDERFLOW;
 
-	// Check the CRC of the message
-	if (!ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_REC, g_ucaRXBuffer, g_ucaRXBuffer[MSG_LEN_IDX] + CRC_SZ))
+	// The CRC was run as the bytes came in, the register is zero for a good message
+	if (ucIndex != (ucLength + CRC_SZ) || !CRC16_IS_GOOD(g_ucaCOMM_RXCRC))
 		return COMM_ERROR;
 
-	for (ucLoopCount = 0x00; ucLoopCount < ucLength; ucLoopCount++)
-		*pucBuff++ = g_ucaRXBuffer[ucLoopCount];
-
-	// Reset the RX index
-	g_ucRXBufferIndex = 0x00;
-
 	return COMM_OK;
 }
 
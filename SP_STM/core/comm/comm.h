@@ -106,6 +106,39 @@
 #define P_INT_IE         P2IE
 //! @}
 
+//! @name USCI Link Defines
+//! Setting COMM_USE_USCI to 1 builds comm_usci.c instead of the bit banged
+//! link in comm.c.  The CP link then runs on USCI_B0 in I2C slave mode and
+//! bytes are moved by the USCI interrupts while the core sleeps.
+//!
+//! The USCI_B0 pins are P3.1 (SDA) and P3.2 (SCL), which are used for STM
+//! power on the current SP-STM board, so this option needs a board with the
+//! CP link routed to those pins.
+//! @{
+//! \def COMM_USE_USCI
+//! \brief Set to 1 to use the USCI_B0 peripheral for the CP link
+#define COMM_USE_USCI		0
+//! \def USCI_SDA_PIN
+//! \brief The USCI_B0 data pin
+#define USCI_SDA_PIN		BIT1
+//! \def USCI_SCL_PIN
+//! \brief The USCI_B0 clock pin
+#define USCI_SCL_PIN		BIT2
+//! \def P_USCI_SEL
+//! \brief The PxSEL register of the USCI_B0 pins
+#define P_USCI_SEL			P3SEL
+//! \def COMM_USCI_OWN_ADDR
+//! \brief The I2C slave address the SP answers to
+#define COMM_USCI_OWN_ADDR	0x48
+//! @}
+
+//! \def COMM_SEGMENTED_ENABLED
+//! \brief Segmented transfers, see MSG_SEG_WINDOW
+//!
+//! The USCI link moves whole messages through its TX buffer, the windows need
+//! the bit banged link where the CP clocks every byte.
+#define COMM_SEGMENTED_ENABLED	(!COMM_USE_USCI)
+
 //! \name Status Flags
 //! These are bit defines that are used to set and clear the
 //! g_ucCOMM_Flags register.
@@ -125,12 +158,18 @@
 //! \def COMM_START_CONDITION
 //! \brief Bit define - Indicates a start bit has been received
 #define COMM_START_CONDITION 0x10
+//! \def COMM_RX_DONE
+//! \brief Bit define - Indicates a complete message is in g_ucaRXBuffer (USCI link only)
+#define COMM_RX_DONE 0x20
 //! @}
 
 //! \name Communication Flags
 //! These are flags are used to pass information between CP and SP in the flags byte
 //! @{
 #define SHUTDOWN_BIT		0x01
+#define CMD_REPORT_BIT		0x02	//!< CP to SP in a COMMAND_PKT: push the REPORT_DATA when the command is done
+#define INT_NOTIFY_BIT		0x04	//!< CP to SP in a SET_THRESHOLD: raise INT_PIN for a crossing, the CP reads it with REQUEST_DATA
+#define CMD_BURST_BIT		0x08	//!< CP to SP in a COMMAND_PKT: the first parameter of an STM transducer is its burst, see COMMAND_PKT
 //! @}
 
 //! \def INT_PIN
@@ -239,6 +278,18 @@
 #define COMM_ACK_ERR					0x10
 //! @}
 
+//! @name Message Buffers
+//! A request is handled in place in g_ucaRXBuffer and its reply is built in
+//! g_ucaCOMM_Reply, defined in comm.c
+//! @{
+//! \var g_ucaRXBuffer
+//! \brief The message received from the CP
+extern volatile uint8 g_ucaRXBuffer[MAXMSGLEN];
+//! \var g_ucaCOMM_Reply
+//! \brief The reply to the message in g_ucaRXBuffer
+extern uint8 g_ucaCOMM_Reply[MAXMSGLEN];
+//! @}
+
 // Comm.c function prototypes
 //! @name Control Functions
 //! These functions handle controlling the \ref comm Module.
@@ -246,6 +297,8 @@
 void vCOMM_Init(void);
 void vCOMM_Shutdown(void);
 uint8 ucCOMM_WaitForMessage(void);
+void vCOMM_RaiseInt(void);
+void vCOMM_ReleaseInt(void);
 //! @}
 
 //! @name Transmit Functions
@@ -253,6 +306,9 @@ uint8 ucCOMM_WaitForMessage(void);
 //! @{
 uint8 ucCOMM_SendByte(uint8 ucChar);
 void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength);
+#if COMM_SEGMENTED_ENABLED
+uint8 ucCOMM_SendSegmented(uint8 ucType, uint8 ucFlags, uint8 (*pfnFill)(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast), uint16 uiCursor);
+#endif
 //! @}
 
 //! @name Receive Functions
@@ -261,7 +317,7 @@ void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength);
 //! @{
 uint8 ucCOMM_WaitForStartCondition(void);
 uint8 ucCOMM_ReceiveByte(void);
-uint8 ucCOMM_GrabMessageFromBuffer(volatile uint8 * pucBuff);
+uint8 ucCOMM_CheckMessage(void);
 //! @}
 
 //! @name Interrupt Handlers
@@ -269,6 +325,10 @@ uint8 ucCOMM_GrabMessageFromBuffer(volatile uint8 * pucBuff);
 //! @{
 __interrupt void PORT2_ISR(void);
 __interrupt void TIMERA0_ISR(void);
+#if COMM_USE_USCI
+__interrupt void USCIAB0TX_ISR(void);
+__interrupt void USCIAB0RX_ISR(void);
+#endif
 //! @}
 
 #endif /*COMM_H_*/
@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file comm_usci.c
+//! \brief This module implements the CP link on the USCI_B0 peripheral
+//!
+//! This module is an alternative to the bit banged link in comm.c and is
+//! built when COMM_USE_USCI is set in comm.h.  The USCI_B0 runs as an I2C
+//! slave and moves the bytes in its interrupts, so the core can sleep while
+//! a message is being received or sent.  The message layer is the same as
+//! the bit banged link: the msg.h header, the ack of the last byte and the
+//! CRC16.  The per-byte parity bit is not part of the I2C framing and is
+//! left to the CRC16.
+//!
+//! @addtogroup core
+//! @{
+//!
+//! @addtogroup comm
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#include <msp430x23x.h>
+#include "core.h"
+#include "comm.h"
+#include "crc.h"
+
+#if COMM_USE_USCI
+
+//******************  Shared Variables (comm.c)  ****************************//
+extern volatile uint8 g_ucCOMM_Flags;
+extern volatile uint8 g_ucaRXBuffer[MAXMSGLEN];
+extern volatile uint8 g_ucRXBufferIndex;
+extern uint8 g_ucaCOMM_RXCRC[CRC_SZ];
+
+//******************  RX Variables  *****************************************//
+//! @name Receive Variables
+//! @{
+//! \var volatile uint8 g_ucRXMessageSize
+//! \brief The size of the message being received, header and CRC included
+volatile uint8 g_ucRXMessageSize;
+//! @}
+
+//******************  TX Variables  *****************************************//
+//! @name Transmit Variables
+//! The message to send is handed off to this buffer so the caller does not
+//! have to wait for the CP to read it out.
+//! @{
+//! \var volatile uint8 g_ucaTXBuffer[MAXMSGLEN]
+//! \brief The USCI TX buffer
+volatile uint8 g_ucaTXBuffer[MAXMSGLEN];
+
+//! \var volatile uint8 g_ucTXBufferIndex
+//! \brief The next byte of g_ucaTXBuffer to send
+volatile uint8 g_ucTXBufferIndex;
+
+//! \var volatile uint8 g_ucTXLength
+//! \brief The number of bytes in g_ucaTXBuffer
+volatile uint8 g_ucTXLength;
+//! @}
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sets up the USCI_B0 as an I2C slave for the CP link
+//!
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+void vCOMM_Init(void)
+{
+	// Hold the USCI in reset while it is configured
+	UCB0CTL1 = UCSWRST;
+
+	// Hand the pins to the USCI
+	P_USCI_SEL |= (USCI_SDA_PIN | USCI_SCL_PIN);
+
+	// I2C slave, 7 bit address
+	UCB0CTL0 = UCMODE_3 | UCSYNC;
+	UCB0I2COA = COMM_USCI_OWN_ADDR;
+
+	// Clear the RX buffer and reset index
+	g_ucRXBufferIndex = MAXMSGLEN;
+	while (g_ucRXBufferIndex) {
+		g_ucRXBufferIndex--;
+		g_ucaRXBuffer[g_ucRXBufferIndex] = 0xFF;
+	}
+	g_ucRXBufferIndex = 0x00;
+	g_ucRXMessageSize = SP_HEADERSIZE;
+
+	// Nothing to send
+	g_ucTXBufferIndex = 0;
+	g_ucTXLength = 0;
+
+	// Release the USCI and enable the start, stop and RX interrupts. The TX
+	// interrupt is enabled when there is something to send.
+	UCB0CTL1 &= ~UCSWRST;
+	UCB0I2CIE = UCSTTIE | UCSTPIE;
+	IE2 |= UCB0RXIE;
+
+	// Enable interrupts on the dedicated interrupt line
+	P_INT_IES &= ~INT_PIN;
+	P_INT_IFG &= ~INT_PIN;
+	P_INT_IE |= INT_PIN;
+
+	g_ucCOMM_Flags = COMM_RUNNING;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Waits for a start condition addressed to this SP
+//!
+//! The USCI detects the start condition and the address in hardware, the
+//! CPU stays in LPM3 (LPM4 when ACLK is not needed) until then.
+//!
+//!   \param None
+//!   \return 1 if start condition received else 0
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucCOMM_WaitForStartCondition(void)
+{
+	// Clear the flag
+	g_ucCOMM_Flags &= ~COMM_START_CONDITION;
+
+	// Wait in deep sleep, LPM4 if the sampling clock is off
+	vPWR_Sleep();
+
+	if (g_ucCOMM_Flags & COMM_START_CONDITION) {
+
+		// Clear the flag
+		g_ucCOMM_Flags &= ~COMM_START_CONDITION;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Hands a single byte to the USCI
+//!
+//!   \param ucTXChar The 8-bit value to send
+//!   \return COMM_OK
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucCOMM_SendByte(uint8 ucTXChar)
+{
+	// Wait for the previous transmission to be read out
+	while (g_ucCOMM_Flags & COMM_TX_BUSY);
+
+	g_ucaTXBuffer[0] = ucTXChar;
+	g_ucTXBufferIndex = 0;
+	g_ucTXLength = 1;
+	g_ucCOMM_Flags |= COMM_TX_BUSY;
+	IE2 |= UCB0TXIE;
+
+	return COMM_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Waits for the USCI to receive the next byte
+//!
+//! The byte is stored in g_ucaRXBuffer by USCIAB0TX_ISR.
+//!
+//!   \param none
+//!   \return COMM_OK, or COMM_ERROR if the message ended first
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucCOMM_ReceiveByte(void)
+{
+	uint8 ucStartIndex;
+
+	ucStartIndex = g_ucRXBufferIndex;
+
+	while (g_ucRXBufferIndex == ucStartIndex) {
+		if (g_ucCOMM_Flags & COMM_RX_DONE)
+			return COMM_ERROR;
+	}
+
+	return COMM_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Shuts off the USCI link
+//!
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+void vCOMM_Shutdown(void)
+{
+	IE2 &= ~(UCB0RXIE | UCB0TXIE);
+	UCB0I2CIE = 0;
+	UCB0CTL1 |= UCSWRST;
+
+	g_ucCOMM_Flags &= ~COMM_RUNNING;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Waits for a message on the serial line
+//!
+//! The USCI interrupts fill g_ucaRXBuffer, the CPU sleeps until the whole
+//! message is in or the CP ends the transfer with a stop condition.
+//!
+//! \param none
+//! \return COMM_OK, or COMM_ERROR if the message is incomplete
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucCOMM_WaitForMessage(void)
+{
+	// Sleep while the bytes move, interrupts are off between the check and the
+	// sleep so the last byte can not slip in unnoticed
+	__disable_interrupt();
+	while (!(g_ucCOMM_Flags & COMM_RX_DONE)) {
+		__bis_SR_register(LPM3_bits | GIE);
+		__disable_interrupt();
+	}
+	g_ucCOMM_Flags &= ~COMM_RX_DONE;
+	__enable_interrupt();
+
+	// Range check the size of the received message
+	if (g_ucRXMessageSize > MAXMSGLEN || g_ucRXMessageSize < SP_HEADERSIZE)
+		return COMM_ERROR;
+
+	if (g_ucRXBufferIndex != g_ucRXMessageSize)
+		return COMM_ERROR;
+
+	//success
+	return COMM_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Hands a data message to the USCI for sending
+//!
+//! The message is copied to g_ucaTXBuffer with the CRC run during the copy.  The
+//! function returns right away and USCIAB0TX_ISR sends the bytes as the CP
+//! reads them.
+//!   \param pBuff Pointer to the message to send
+//!   \param ucLength Length of the message without the CRC
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength)
+{
+	uint8 ucLoopCount;
+	uint8 ucaCRC[CRC_SZ];
+
+	// Wait for the previous message to be read out
+	while (g_ucCOMM_Flags & COMM_TX_BUSY);
+
+	if ((ucLength + CRC_SZ) > MAXMSGLEN)
+		return;
+
+	// Copy the message and run the CRC in the same pass
+	CRC16_INIT(ucaCRC);
+	for (ucLoopCount = 0x00; ucLoopCount < ucLength; ucLoopCount++) {
+		g_ucaTXBuffer[ucLoopCount] = pBuff[ucLoopCount];
+		CRC16_UPDATE_BYTE(pBuff[ucLoopCount], ucaCRC);
+	}
+	g_ucaTXBuffer[ucLength] = ucaCRC[CRC16_HI];
+	g_ucaTXBuffer[ucLength + 1] = ucaCRC[CRC16_LO];
+	ucLength += CRC_SZ;
+
+	g_ucTXBufferIndex = 0;
+	g_ucTXLength = ucLength;
+	g_ucCOMM_Flags |= COMM_TX_BUSY;
+
+	// Release the clock if the CP is already waiting for the reply
+	IE2 |= UCB0TXIE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief USCI_B0 data interrupt, moves one byte in or out
+//!
+//! In I2C mode the USCI_B0 RX and TX flags both use the USCIAB0TX vector.
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+#pragma vector=USCIAB0TX_VECTOR
+__interrupt void USCIAB0TX_ISR(void)
+{
+	uint8 ucRXByte;
+
+	if (IFG2 & UCB0RXIFG) {
+		ucRXByte = UCB0RXBUF;
+
+		if (g_ucRXBufferIndex < MAXMSGLEN) {
+			if (g_ucRXBufferIndex == 0)
+				CRC16_INIT(g_ucaCOMM_RXCRC);
+			CRC16_UPDATE_BYTE(ucRXByte, g_ucaCOMM_RXCRC);
+			g_ucaRXBuffer[g_ucRXBufferIndex++] = ucRXByte;
+		}
+
+		// Once the header is in we know how long the message is
+		if (g_ucRXBufferIndex == SP_HEADERSIZE)
+			g_ucRXMessageSize = g_ucaRXBuffer[MSG_LEN_IDX] + CRC_SZ;
+
+		if (g_ucRXBufferIndex == g_ucRXMessageSize) {
+			g_ucCOMM_Flags &= ~COMM_RX_BUSY;
+			g_ucCOMM_Flags |= COMM_RX_DONE;
+			__bic_SR_register_on_exit(LPM4_bits);
+		}
+	}
+
+	if (IFG2 & UCB0TXIFG) {
+		if (g_ucTXLength == 0) {
+			// No reply yet, the USCI stretches the clock until vCOMM_SendMessage() hands one over
+			IE2 &= ~UCB0TXIE;
+		}
+		else if (g_ucTXBufferIndex < g_ucTXLength) {
+			UCB0TXBUF = g_ucaTXBuffer[g_ucTXBufferIndex++];
+
+			if (g_ucTXBufferIndex == g_ucTXLength)
+				g_ucCOMM_Flags &= ~COMM_TX_BUSY;
+		}
+		else {
+			// The CP read past the end of the message
+			UCB0TXBUF = 0xFF;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief USCI_B0 state interrupt, handles the start and stop conditions
+//!
+//!   \param None
+//!   \return None
+///////////////////////////////////////////////////////////////////////////////
+#pragma vector=USCIAB0RX_VECTOR
+__interrupt void USCIAB0RX_ISR(void)
+{
+	// Start condition (or repeated start) with our address
+	if (UCB0STAT & UCSTTIFG) {
+		UCB0STAT &= ~UCSTTIFG;
+
+		// The CP is writing, start a new message and drop any reply it did not read
+		if (!(UCB0CTL1 & UCTR)) {
+			g_ucTXLength = 0;
+			g_ucCOMM_Flags &= ~COMM_TX_BUSY;
+			g_ucRXBufferIndex = 0;
+			g_ucRXMessageSize = SP_HEADERSIZE;
+			g_ucCOMM_Flags &= ~COMM_RX_DONE;
+			g_ucCOMM_Flags |= COMM_RX_BUSY;
+		}
+
+		g_ucCOMM_Flags |= COMM_START_CONDITION;
+		__bic_SR_register_on_exit(LPM4_bits);
+	}
+
+	// Stop condition, a message that was cut short is finished here
+	if (UCB0STAT & UCSTPIFG) {
+		UCB0STAT &= ~UCSTPIFG;
+
+		if (g_ucCOMM_Flags & COMM_RX_BUSY) {
+			g_ucCOMM_Flags &= ~COMM_RX_BUSY;
+			g_ucCOMM_Flags |= COMM_RX_DONE;
+			__bic_SR_register_on_exit(LPM4_bits);
+		}
+	}
+}
+
+#endif // COMM_USE_USCI
+
+//! @}
+//! @}
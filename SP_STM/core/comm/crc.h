@@ -6,6 +6,9 @@
 * V1.00 10/07/2002 wzr
 *	started
 *
+* V1.01
+*	Added the byte wide update macro so the CRC can be run per byte
+*
 ******************************************************************************/
 
 #ifndef CRC_H_INCLUDED
@@ -16,9 +19,36 @@
 #define CRC_FOR_MSG_TO_REC  0
 #define CRC_SZ 2
 
+/* CRC16 "REGISTER" (IMPLEMENTED AS TWO 8BIT VALUES) */
+#define CRC16_HI 0					// index into ucCRCarray[]
+#define CRC16_LO 1					// same
+
+/* BYTE WIDE CRC-CCITT LOOKUP TABLES (IN FLASH) */
+extern const unsigned char ucaCRC16_lookupHI[256];
+extern const unsigned char ucaCRC16_lookupLO[256];
+
+/* LOAD THE CRC REG WITH 0XFFFF AS PER CCITT SPEC */
+#define CRC16_INIT(ucCRCarray)	{ (ucCRCarray)[CRC16_HI] = 0xFF; (ucCRCarray)[CRC16_LO] = 0xFF; }
+
+/* ADD ONE BYTE TO THE CRC REG, ONE TABLE LOOKUP.  USED INLINE BY THE COMM BYTE ROUTINES */
+#define CRC16_UPDATE_BYTE(ucByteVal, ucCRCarray)											\
+		{																					\
+		unsigned char ucCRCIdx = (ucCRCarray)[CRC16_HI] ^ (unsigned char)(ucByteVal);		\
+		(ucCRCarray)[CRC16_HI] = (ucCRCarray)[CRC16_LO] ^ ucaCRC16_lookupHI[ucCRCIdx];		\
+		(ucCRCarray)[CRC16_LO] = ucaCRC16_lookupLO[ucCRCIdx];								\
+		}
+
+/* A RECEIVED MSG RUN THROUGH THE CRC INCLUDING ITS OWN CRC LEAVES THE REG AT ZERO */
+#define CRC16_IS_GOOD(ucCRCarray)	(!(ucCRCarray)[CRC16_HI] && !(ucCRCarray)[CRC16_LO])
+
 
 /* ROUTINE DEFINITIONS */
 
+void vCRC16_updateByte(
+		unsigned char ucByteVal,		//byte to add to CRC
+		unsigned char ucCRCarray[2]		//CRC current value
+		);
+
 unsigned char ucCRC16_compute_msg_CRC(		/* RET:	1=CRC is OK, 0=CRC mismatch */
 		unsigned char ucMsgFlag,	//send msg or receive msg flag
 		volatile unsigned char *ucMSGBuff, 				//pointer to the message
@@ -28,6 +28,10 @@
 //! return message can be a data message or a label message.
 //! @{
 #define SP_DATAMESSAGE_VERSION 120     //!< Version 1.20
+#define SP_PACKEDDATA_VERSION 130      //!< Version 1.30, REPORT_DATA packed, see REPORT_DATA
+#define SP_PACKEDDELTA_VERSION 131     //!< Version 1.31, REPORT_DATA packed and deltas allowed
+#define SP_PACKEDVWC_VERSION 132       //!< Version 1.32, REPORT_DATA packed with the water contents
+#define SP_SEGMENTED_VERSION 140       //!< Version 1.40, bulk replies as a segmented transfer, see MSG_SEG_WINDOW
 // Message Types
 //! @name Data Message Types
 //! These are the possible data message types.
@@ -37,6 +41,19 @@
 //! what functions to execute.
 //!
 //! The SP Board replies with a CONFIRM_COMMAND if the command is valid
+//!
+//! With CMD_REPORT_BIT set in the flags the CP does not send a REQUEST_DATA.
+//! Once the command is done the SP raises INT_PIN and sends the REPORT_DATA
+//! at the next start condition.  If none comes within CORE_REPORT_WAIT_S the
+//! SP lets go of INT_PIN and the readings wait for a REQUEST_DATA.  The
+//! version byte of the COMMAND_PKT selects the report format the same way
+//! the one of REQUEST_DATA does.
+//!
+//! With CMD_BURST_BIT set the first parameter byte of an STM transducer is
+//! the number of frames per measurement, 1 to STM_BURST_MAX.  The count is
+//! stored in flash and holds for every later command and for the background
+//! samples until it is set again.  Without the bit the parameters are passed
+//! to the transducer as before and the burst is left as it is.
 #define COMMAND_PKT   		0x01
 
 //! \def REPORT_DATA
@@ -45,13 +62,48 @@
 //! This packet is only sent from the SP Board board to the CP Board. The
 //! transducer measurement is contained in data1 through data 8.
 //! The SP sends a 128 (1-8) bit or 32 (1-2) bit data packet, depending on the SP function
+//!
+//! A CP that puts SP_PACKEDDATA_VERSION or later in the version byte of
+//! REQUEST_DATA gets a packed reply with that version.  The payload is:
+//! - a 16 bit bitmap, low byte first: bit n set = data generator n present,
+//!   plus the PACKED_DELTA and PACKED_RAW flags
+//! - a report number, incremented with every packed reply
+//! - a second bitmap of the raw entries, only if PACKED_RAW is set
+//! - per present generator in order: a raw entry is {length, bytes}, every
+//!   other entry is a zig-zag varint (7 bits per byte, low group first, bit 7
+//!   set = more follows) of the signed value
+//! - from SP_PACKEDVWC_VERSION on, the reply has that version and ends with
+//!   a byte with bit n set = STM n + 1 is a 5TM or 5TE with a soil reading in
+//!   this report, then per set bit, lowest first, a varint of its volumetric
+//!   water content in 0.1 %
+//!
+//! The packed values are in engineering units: a 5TM or 5TE temperature is
+//! in degrees C x10 where the v1.20 reply has the raw value the sensor sent.
+//! The soil entry of a 5TM or 5TE is the raw dielectric in both.
+//!
+//! With PACKED_DELTA set every varint is the difference to the value of that
+//! generator in the previous packed replies.  Deltas are only sent to a CP
+//! that asks with SP_PACKEDDELTA_VERSION, and it must apply them only if the
+//! report number follows the last one it received.  Otherwise it asks again
+//! with SP_PACKEDDATA_VERSION for absolute values.
 #define REPORT_DATA     	0x02
 
+//! @name Packed REPORT_DATA Flags
+//! Flags in the bitmap of a packed REPORT_DATA
+//! @{
+#define PACKED_DELTA		0x8000	//!< The values are deltas
+#define PACKED_RAW			0x4000	//!< A bitmap of raw entries follows the report number
+//! @}
+
 //! \def PROGRAM_CODE
 //! \brief This packet contains program code
 //!
 //! This packet is only sent from the real-time-data-center to the target. The
 //! packet contains a portion of a programming update.
+//!
+//! The SP does not take it and answers REPORT_ERROR.  A staged image and the
+//! running image do not both fit the flash beside the log, so the firmware is
+//! still updated through the BSL, see REQUEST_BSL_PW.
 
 #define PROGRAM_CODE     	0x03
 
@@ -69,6 +121,12 @@
 //! The packet is sent from the CP Board to the SP Board and the CP Board will
 //! expect a SP_LabelMessage in return. At this time the data1 and
 //! data2 fields in the message contain do-not-care values.
+//!
+//! With SP_SEGMENTED_VERSION the SP describes every transducer in one
+//! segmented transfer instead: the number of transducers, then for each of
+//! transducer 1 on the type, the sensor type, the sample duration in ms (low
+//! byte first, the average measured time once there is one) and the label.
+//! The reply is kept ready in RAM.
 #define REQUEST_LABEL   	0x05
 
 //! \def ID_PKT
@@ -96,6 +154,9 @@
 
 //! \def INTERROGATE
 //! \brief This packet is used by the CP board to request the transducer information
+//!
+//! With SP_SEGMENTED_VERSION the reply is the transfer of a segmented
+//! REQUEST_LABEL, with INTERROGATE as its type.
 #define INTERROGATE   		0x0A
 
 //! \def SET_SERIALNUM
@@ -108,7 +169,56 @@
 
 //! \def REQUEST_SENSOR_TYPE
 //! \brief This packet is used by the CP board to request the sensor type
+//!
+//! The types are kept across resets and refreshed by every good measurement,
+//! so a COMMAND_SENSOR_TYPE scan is only needed for sensors never read.
 #define REQUEST_SENSOR_TYPE			0x0D
+
+//! \def SET_SAMPLE_INTERVAL
+//! \brief This packet is used by the CP board to set the background sampling interval of transducers
+//!
+//! The payload is a list of 3 byte entries: the transducer number followed by the
+//! interval in seconds, low byte first.  An interval of 0 stops the background
+//! sampling of that transducer.  The SP replies with a CONFIRM_COMMAND.
+#define SET_SAMPLE_INTERVAL			0x0E
+
+//! \def REQUEST_LOG
+//! \brief This packet is used by the CP board to read back the measurement log
+//!
+//! The payload is the first sequence number wanted, low byte first.  The SP
+//! replies with a REQUEST_LOG packet holding the records from there on, see
+//! ucLog_Fetch().  An empty reply means the CP is up to date.
+//!
+//! A CP that asks with SP_SEGMENTED_VERSION gets every record from there on
+//! in one segmented transfer, one ucLog_Fetch() payload per frame.
+#define REQUEST_LOG					0x0F
+
+//! \def REQUEST_DIAG
+//! \brief This packet is used by the CP board to read the diagnostics statistics
+//!
+//! The optional payload is the phase to report (default 0) and a byte that
+//! clears the statistics after the reply when it is 1.  The SP replies with a
+//! REQUEST_DIAG packet, see ucDiag_Fetch(), followed by the health of the
+//! transducers, see ucMain_FetchHealth().  The health and the stack
+//! high-water mark are not cleared.
+#define REQUEST_DIAG				0x10
+
+//! \def SET_THRESHOLD
+//! \brief This packet is used by the CP board to set the soil moisture thresholds of transducers
+//!
+//! The payload is a list of 5 byte entries: the transducer number, the
+//! threshold and the hysteresis, both low byte first, in the units of the
+//! soil value or in 0.1 % water content for a 5TM or 5TE.  A background sample
+//! that moves more than the hysteresis above or below the threshold, from
+//! the other side, is a crossing.  A hysteresis of 0xFFFF turns the check
+//! off.  The SP replies with a CONFIRM_COMMAND.
+//!
+//! INT_PIN is only raised for a crossing if the CP sets INT_NOTIFY_BIT in the
+//! flags, which promises to leave the line undriven until the next
+//! SET_THRESHOLD without the bit or a reset of the SP.  The CP fetches the
+//! report with a normal REQUEST_DATA, which lets go of INT_PIN again.
+//! Without the bit the crossings are only in the readings.
+#define SET_THRESHOLD				0x11
 //! @}
 
 //! \def MAXMSGLEN
@@ -119,6 +229,26 @@
 //! \brief The size of the header portion of the SP message
 #define SP_HEADERSIZE		4
 
+//! @name Segmented Transfers
+//! A bulk reply to a request with SP_SEGMENTED_VERSION is sent as frames
+//! back to back after the one start condition of the reply.  It starts with
+//! a header carrying the type of the request, SP_HEADERSIZE as the length and
+//! SP_SEGMENTED_VERSION.  Every frame is {sequence, length, payload}: the
+//! sequence counts from 0 and has MSG_SEG_LAST set on the last frame.
+//!
+//! After MSG_SEG_WINDOW frames, or after the last one, the SP sends the CRC16
+//! of the window, the header included in the first one, and clocks in one
+//! byte from the CP.  MSG_SEG_ACK moves on to the next window, anything else
+//! has the window sent again.  The per byte ack bits are not checked inside a
+//! window.
+//! @{
+#define MSG_SEG_WINDOW		4		//!< Frames per window
+#define MSG_SEG_LAST		0x80	//!< Sequence byte flag of the last frame
+#define MSG_SEG_ACK			0x06	//!< The CP received the window
+#define MSG_SEG_TRIES		3		//!< Times a window is sent before the transfer is given up
+#define MSG_SEG_MAX_PAYLOAD	(MAXMSGLEN - SP_HEADERSIZE - 2)	//!< Longest frame payload, the same as a message with its CRC
+//! @}
+
 //! @name Message Indices
 //! \brief Indices for elements of a message
 //! @{
@@ -0,0 +1,337 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file config.c
+//! \brief This module keeps the board configuration in information flash
+//!
+//! Values are stored as records appended to erased flash, the newest record
+//! of a key is its value.  Changing a value costs one record write, a segment
+//! is only erased when the active one is full and the store moves on to the
+//! next segment of the ring.
+//!
+//! @addtogroup core
+//! @{
+//!
+
+#include <msp430F235.h>
+#include "core.h"
+#include "config.h"
+
+//******************  Config Variables  *************************************//
+//! @name Config Variables
+//! Found again by vConfig_Init() after every reset.
+//! @{
+//! \var uint8 g_ucConfig_Active
+//! \brief The segment holding the values, CONFIG_NUM_SEGMENTS if there is no store yet
+uint8 g_ucConfig_Active;
+
+//! \var uint8 g_ucConfig_Free
+//! \brief Word offset of the next record in the active segment
+uint8 g_ucConfig_Free;
+//! @}
+
+//! \var g_ucaConfig_KeyWords
+//! \brief The value words of each key, see the Key Budget, 0 for a key not in use
+static const uint8 g_ucaConfig_KeyWords[CONFIG_LAST_KEY + 1] =
+{
+	0,
+	CONFIG_WORDS_HID,
+	CONFIG_WORDS_INTERVALS,
+	CONFIG_WORDS_SENSOR_TYPES,
+	0,
+	CONFIG_WORDS_STM_LATENCY,
+	CONFIG_WORDS_STM_BURST,
+	CONFIG_WORDS_THRESHOLDS
+};
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the flash address of a segment of the ring
+//!
+//! \param ucSegment, 0 to CONFIG_NUM_SEGMENTS - 1
+//! \return uint16 address
+///////////////////////////////////////////////////////////////////////////////
+static uint16 uiConfig_Address(uint8 ucSegment)
+{
+	return FLASH_INFO_D + ucSegment * INFO_SEGMENTLENGTH;
+}
+
+//! \def puiConfig_Segment
+//! \brief Pointer to the words of a segment
+#define puiConfig_Segment(ucSegment)	((uint16 *) uiConfig_Address(ucSegment))
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the length of a record if a complete one starts at a word
+//!
+//! \param puiSegment, the segment
+//! \param ucWord, word offset in the segment
+//! \return The number of words of the record, 0 if there is none
+///////////////////////////////////////////////////////////////////////////////
+static uint8 ucConfig_RecordLength(uint16 *puiSegment, uint8 ucWord)
+{
+	uint8 ucCount;
+
+	if ((ucWord >= CONFIG_SEGMENT_WORDS) || (puiSegment[ucWord] == 0xFFFF))
+		return 0;
+
+	ucCount = (uint8) (puiSegment[ucWord] >> 8);
+	if ((ucCount == 0) || (ucCount > CONFIG_MAX_WORDS) || (ucWord + 1 + ucCount > CONFIG_SEGMENT_WORDS))
+		return 0;
+
+	return 1 + ucCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Finds the newest record of a key in the active segment
+//!
+//! \param ucKey, the key
+//! \return Pointer to the tag word of the record, NULL if the key is not stored
+///////////////////////////////////////////////////////////////////////////////
+static uint16 *puiConfig_Find(uint8 ucKey)
+{
+	uint16 *puiSegment;
+	uint16 *puiFound;
+	uint8 ucWord;
+	uint8 ucLength;
+
+	if (g_ucConfig_Active >= CONFIG_NUM_SEGMENTS)
+		return NULL;
+
+	puiSegment = puiConfig_Segment(g_ucConfig_Active);
+	puiFound = NULL;
+
+	ucWord = CONFIG_FIRST_RECORD;
+	while ((ucLength = ucConfig_RecordLength(puiSegment, ucWord)) != 0)
+	{
+		if ((uint8) puiSegment[ucWord] == ucKey)
+			puiFound = &puiSegment[ucWord];
+		ucWord += ucLength;
+	}
+
+	return puiFound;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Moves the store to the next segment of the ring
+//!
+//! The next segment is erased and gets the newest record of every key, then
+//! the new record.  The header goes in last, a reset before it leaves the old
+//! segment active.  Without a store the ring starts at INFO C so the HID of a
+//! board set up before the store stays in INFO D until it has been copied.
+//!
+//! \param ucKey, the key of the new record, 0 for none
+//! \param puiData, the value words
+//! \param ucCount, the number of value words
+//! \return 0 on success, 1 if the flash controller reported a failure
+///////////////////////////////////////////////////////////////////////////////
+static uint8 ucConfig_Rotate(uint8 ucKey, uint16 *puiData, uint8 ucCount)
+{
+	uint16 *puiOld;
+	uint16 uiAddress;
+	uint16 uiaHeader[2];
+	uint16 uiTag;
+	uint8 ucNew;
+	uint8 ucWord;
+	uint8 ucOldWord;
+	uint8 ucLength;
+	uint8 ucFail;
+
+	if (g_ucConfig_Active >= CONFIG_NUM_SEGMENTS)
+	{
+		ucNew = 1;
+		uiaHeader[CONFIG_GEN_WORD] = 0;
+	}
+	else
+	{
+		ucNew = (g_ucConfig_Active + 1) % CONFIG_NUM_SEGMENTS;
+		uiaHeader[CONFIG_GEN_WORD] = puiConfig_Segment(g_ucConfig_Active)[CONFIG_GEN_WORD] + 1;
+	}
+	uiaHeader[CONFIG_FORMAT_WORD] = CONFIG_FORMAT;
+	uiAddress = uiConfig_Address(ucNew);
+
+	vFlash_init();
+	vFlash_Erase_Seg(uiAddress);
+
+	ucFail = 0;
+	ucWord = CONFIG_FIRST_RECORD;
+
+	// Copy the values still in use, the new record replaces the one of its key
+	if (g_ucConfig_Active < CONFIG_NUM_SEGMENTS)
+	{
+		puiOld = puiConfig_Segment(g_ucConfig_Active);
+
+		ucOldWord = CONFIG_FIRST_RECORD;
+		while ((ucLength = ucConfig_RecordLength(puiOld, ucOldWord)) != 0)
+		{
+			if (((uint8) puiOld[ucOldWord] != ucKey) && (puiConfig_Find((uint8) puiOld[ucOldWord]) == &puiOld[ucOldWord]))
+			{
+				ucFail |= ucFlash_Write_Ints(&puiOld[ucOldWord], uiAddress + 2 * ucWord, ucLength);
+				ucWord += ucLength;
+			}
+			ucOldWord += ucLength;
+		}
+	}
+
+	if (ucKey)
+	{
+		if (ucWord + 1 + ucCount > CONFIG_SEGMENT_WORDS)
+			return 1;
+
+		uiTag = (uint16) ucKey | ((uint16) ucCount << 8);
+		ucFail |= ucFlash_Write_Ints(&uiTag, uiAddress + 2 * ucWord, 1);
+		ucFail |= ucFlash_Write_Ints(puiData, uiAddress + 2 * (ucWord + 1), ucCount);
+		ucWord += 1 + ucCount;
+	}
+
+	if (ucFail)
+		return 1;
+
+	if (ucFlash_Write_Ints(uiaHeader, uiAddress, 2))
+		return 1;
+
+	g_ucConfig_Active = ucNew;
+	g_ucConfig_Free = ucWord;
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Finds the active segment after a reset
+//!
+//! The active segment is the one with a header and the newest generation.
+//! The next record goes behind its last complete record.  If a reset cut off
+//! a record the segment is treated as full, so the next write moves on.
+//!
+//! A board without a store has its HID in the first words of INFO D, it is
+//! moved into the store.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vConfig_Init(void)
+{
+	uint16 *puiSegment;
+	uint16 uiaHID[4];
+	uint8 ucSegment;
+	uint8 ucWord;
+	uint8 ucLength;
+
+	g_ucConfig_Active = CONFIG_NUM_SEGMENTS;
+	g_ucConfig_Free = CONFIG_SEGMENT_WORDS;
+
+	for (ucSegment = 0; ucSegment < CONFIG_NUM_SEGMENTS; ucSegment++)
+	{
+		puiSegment = puiConfig_Segment(ucSegment);
+		if (puiSegment[CONFIG_FORMAT_WORD] != CONFIG_FORMAT)
+			continue;
+
+		if ((g_ucConfig_Active >= CONFIG_NUM_SEGMENTS)
+				|| ((int16) (puiSegment[CONFIG_GEN_WORD] - puiConfig_Segment(g_ucConfig_Active)[CONFIG_GEN_WORD]) > 0))
+			g_ucConfig_Active = ucSegment;
+	}
+
+	if (g_ucConfig_Active >= CONFIG_NUM_SEGMENTS)
+	{
+		puiSegment = puiConfig_Segment(0);
+		for (ucWord = 0; ucWord < 4; ucWord++)
+			uiaHID[ucWord] = puiSegment[(HID_ADDRESS / 2) + ucWord];
+
+		if ((uiaHID[0] & uiaHID[1] & uiaHID[2] & uiaHID[3]) != 0xFFFF)
+			ucConfig_Rotate(CONFIG_KEY_HID, uiaHID, 4);
+
+		return;
+	}
+
+	puiSegment = puiConfig_Segment(g_ucConfig_Active);
+
+	ucWord = CONFIG_FIRST_RECORD;
+	while ((ucLength = ucConfig_RecordLength(puiSegment, ucWord)) != 0)
+		ucWord += ucLength;
+	g_ucConfig_Free = ucWord;
+
+	// Anything behind the last record is left from a write cut off by a reset
+	for (; ucWord < CONFIG_SEGMENT_WORDS; ucWord++)
+	{
+		if (puiSegment[ucWord] != 0xFFFF)
+		{
+			g_ucConfig_Free = CONFIG_SEGMENT_WORDS;
+			break;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Reads the value of a key
+//!
+//! \param ucKey, the key
+//! \param puiData, destination of the value words
+//! \param ucCount, the number of words wanted, words the record does not have are left alone
+//! \return 0 on success, 1 if the key is not stored
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucConfig_Read(uint8 ucKey, uint16 *puiData, uint8 ucCount)
+{
+	uint16 *puiTag;
+	uint8 ucIdx;
+
+	puiTag = puiConfig_Find(ucKey);
+	if (puiTag == NULL)
+		return 1;
+
+	if (ucCount > (uint8) (*puiTag >> 8))
+		ucCount = (uint8) (*puiTag >> 8);
+
+	for (ucIdx = 0; ucIdx < ucCount; ucIdx++)
+		puiData[ucIdx] = puiTag[1 + ucIdx];
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Stores the value of a key
+//!
+//! The value words go in first, the tag word last commits the record.  An
+//! unchanged value is not written again.
+//!
+//! \param ucKey, one of the Record Keys
+//! \param puiData, the value words
+//! \param ucCount, the number of words, 1 to the budget of the key
+//! \return 0 on success, 1 on an unknown key, a bad length or a failed flash write
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucConfig_Write(uint8 ucKey, uint16 *puiData, uint8 ucCount)
+{
+	uint16 *puiTag;
+	uint16 uiTag;
+	uint16 uiAddress;
+	uint8 ucIdx;
+	uint8 ucFail;
+
+	if ((ucKey == 0) || (ucKey > CONFIG_LAST_KEY) || (ucCount == 0) || (ucCount > g_ucaConfig_KeyWords[ucKey]))
+		return 1;
+
+	uiTag = (uint16) ucKey | ((uint16) ucCount << 8);
+
+	puiTag = puiConfig_Find(ucKey);
+	if ((puiTag != NULL) && (*puiTag == uiTag))
+	{
+		for (ucIdx = 0; ucIdx < ucCount; ucIdx++)
+		{
+			if (puiTag[1 + ucIdx] != puiData[ucIdx])
+				break;
+		}
+		if (ucIdx == ucCount)
+			return 0;
+	}
+
+	if ((g_ucConfig_Active >= CONFIG_NUM_SEGMENTS) || (g_ucConfig_Free + 1 + ucCount > CONFIG_SEGMENT_WORDS))
+		return ucConfig_Rotate(ucKey, puiData, ucCount);
+
+	uiAddress = uiConfig_Address(g_ucConfig_Active) + 2 * g_ucConfig_Free;
+
+	vFlash_init();
+	ucFail = ucFlash_Write_Ints(puiData, uiAddress + 2, ucCount);
+	if (!ucFail)
+		ucFail = ucFlash_Write_Ints(&uiTag, uiAddress, 1);
+
+	g_ucConfig_Free += 1 + ucCount;
+
+	return ucFail;
+}
+
+//! @}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file config.h
+//! \brief Header file for the configuration store module
+//!
+//!
+//! @addtogroup core
+//! @{
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+//! @name Store Geometry
+//! The store is a log of records over the INFO D, C and B segments.  A
+//! changed value is appended to the active segment, only a full segment costs
+//! an erase: the newest record of every key is copied to the next segment of
+//! the ring and that segment becomes active.
+//! @{
+//! \def CONFIG_NUM_SEGMENTS
+//! \brief Segments in the ring, starting at FLASH_INFO_D
+#define CONFIG_NUM_SEGMENTS		3
+
+//! \def CONFIG_SEGMENT_WORDS
+//! \brief Words in one segment
+#define CONFIG_SEGMENT_WORDS	(INFO_SEGMENTLENGTH / 2)
+
+//! \def CONFIG_FORMAT
+//! \brief Second header word of an active segment, the format marker and version 1
+#define CONFIG_FORMAT			0xC601
+
+//! \def CONFIG_MAX_WORDS
+//! \brief The longest value that can be stored
+#define CONFIG_MAX_WORDS		8
+//! @}
+
+//! @name Segment Word Offsets
+//! The header is written last and marks the segment as complete.
+//! @{
+#define CONFIG_GEN_WORD			0	//!< Generation, incremented with every segment change
+#define CONFIG_FORMAT_WORD		1	//!< CONFIG_FORMAT, 0xFFFF while the segment is being filled
+#define CONFIG_FIRST_RECORD		2	//!< The first record follows the header
+//! @}
+
+//! @name Record Keys
+//! A record is a tag word, the key in the low byte and the number of value
+//! words in the high byte, and the value words.  The tag is written last.
+//! Key 0x04 was never written and is not given out again.
+//! @{
+#define CONFIG_KEY_HID			0x01	//!< The 4 words of the hardware ID
+#define CONFIG_KEY_INTERVALS	0x02	//!< Background sample interval of each sampled transducer
+#define CONFIG_KEY_SENSOR_TYPES	0x03	//!< STM sensor type bytes, channel 1 in the low byte of the first word
+#define CONFIG_KEY_STM_LATENCY	0x05	//!< Learned STM excite to first start bit latency in ms, one word per timing profile
+#define CONFIG_KEY_STM_BURST	0x06	//!< Frames per STM measurement, channel 1 in the low byte of the first word
+#define CONFIG_KEY_THRESHOLDS	0x07	//!< Threshold and hysteresis of each sampled transducer
+#define CONFIG_LAST_KEY			0x07	//!< The highest key in use
+//! @}
+
+//! @name Key Budget
+//! The value words of each key.  ucConfig_Write() takes no more, so a
+//! rotation always has room for the newest record of every key.  The records
+//! of all keys together must fit a segment, checked below; a new key has to
+//! fit the words that are left.
+//! @{
+#define CONFIG_WORDS_HID			4
+#define CONFIG_WORDS_INTERVALS		NUM_SAMPLED_TRANSDUCERS
+#define CONFIG_WORDS_SENSOR_TYPES	(NUM_STM_CHANNELS / 2)
+#define CONFIG_WORDS_STM_LATENCY	STM_NUM_PROFILES
+#define CONFIG_WORDS_STM_BURST		(NUM_STM_CHANNELS / 2)
+#define CONFIG_WORDS_THRESHOLDS		(2 * NUM_SAMPLED_TRANSDUCERS)
+
+//! \def CONFIG_KEY_SET_WORDS
+//! \brief Words of a segment holding a record of every key, header included
+#define CONFIG_KEY_SET_WORDS	(CONFIG_FIRST_RECORD + (1 + CONFIG_WORDS_HID) + (1 + CONFIG_WORDS_INTERVALS) \
+		+ (1 + CONFIG_WORDS_SENSOR_TYPES) + (1 + CONFIG_WORDS_STM_LATENCY) + (1 + CONFIG_WORDS_STM_BURST) \
+		+ (1 + CONFIG_WORDS_THRESHOLDS))
+
+#if CONFIG_KEY_SET_WORDS > CONFIG_SEGMENT_WORDS
+  #error "The records of the config keys do not fit a segment of the store"
+#endif
+#if (CONFIG_WORDS_INTERVALS > CONFIG_MAX_WORDS) || (CONFIG_WORDS_STM_LATENCY > CONFIG_MAX_WORDS) || (CONFIG_WORDS_THRESHOLDS > CONFIG_MAX_WORDS)
+  #error "A config key is longer than CONFIG_MAX_WORDS"
+#endif
+//! @}
+
+// config.c function prototypes
+//! @name config module Functions
+//! These functions read and write the configuration store
+//! @{
+void vConfig_Init(void);
+uint8 ucConfig_Read(uint8 ucKey, uint16 *puiData, uint8 ucCount);
+uint8 ucConfig_Write(uint8 ucKey, uint16 *puiData, uint8 ucCount);
+//! @}
+
+#endif /*CONFIG_H_*/
+//! @}
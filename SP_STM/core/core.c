@@ -37,6 +37,14 @@
 //! \brief Variable holds the unique SP ID as a byte array
 uint16 uiHID[4];
 
+//! \var g_ucCORE_ReportPending
+//! \brief Set while INT_PIN is raised for a REPORT_DATA nobody asked for, see vCORE_PostReport()
+static uint8 g_ucCORE_ReportPending;
+
+//! \var g_ucCORE_NotifyMode
+//! \brief Set while the CP has asked for INT_NOTIFY_BIT, cleared by a reset
+static uint8 g_ucCORE_NotifyMode;
+
 //******************  Functions  ********************************************//
 ///////////////////////////////////////////////////////////////////////////////
 //! \brief This function starts up the Core and configures hardware & RAM
@@ -69,6 +77,11 @@ void vCORE_Initilize(void)
 	// ACLK = VLO/4
 	BCSCTL1 |= DIVA_2;
 
+#if DIAG_ENABLED
+	// Paint the stack while it is shallow, REQUEST_DIAG reports how deep it got
+	vDiag_PaintStack();
+#endif
+
 	// Configure the pins
 	P1OUT = CoreP1OUT;
 	P1DIR = CoreP1DIR;
@@ -103,8 +116,22 @@ void vCORE_Initilize(void)
 	// All core modules get initialized now
 	vCOMM_Init();
 
-	// Get the SPs serial number from flash
-	vFlash_GetHID(uiHID);
+	// Get the SPs serial number from the config store, an unset HID reads as erased flash
+	vConfig_Init();
+	uiHID[0] = uiHID[1] = uiHID[2] = uiHID[3] = 0xFFFF;
+	ucConfig_Read(CONFIG_KEY_HID, uiHID, 4);
+
+	// Find the head of the measurement log
+	vLog_Init();
+
+	// No timers or events until the application sets them up, the VLO is
+	// calibrated here while TimerB is still free
+	vSched_Init();
+
+#if DIAG_ENABLED
+	// Clear the statistics and start the diagnostics clock
+	vDiag_Init();
+#endif
 
 	// Enable interrupts
 	__bis_SR_register(GIE);
@@ -115,39 +142,20 @@ void vCORE_Initilize(void)
 //! \brief Measure the MSP430 supply voltage
 //!
 //! Uses the ADC12 to measure the input voltage. Uses the MEM15 register.
+//! Starts a conversion of the supply monitor and sleeps in LPM0 until
+//! ADC12_ISR has added it to the running average.
 //!
 //!   \param none
 //!
-//!   \return unsigned int Input voltage * 100
+//!   \return unsigned int Input voltage * 100, the running average
 ///////////////////////////////////////////////////////////////////////////////
 
 unsigned int unCORE_GetVoltage(void)
 {
-	int rt_volts;
-
-	ADC12CTL0 &= ~(SHT10 + SHT12 + SHT13 + MSC + ADC12OVIE + ADC12TOVIE + ENC + ADC12SC); //ADC12CTL0 &= ~0xD08F = ~1101 0000 1000 1111 //Have to turn ENC Off first
-	ADC12CTL0 |= (SHT11 + REF2_5V + REFON + ADC12ON); //ADC12CTL0 |= 0x2070 = 0010 xxxx 0111 00(11)* - 16-Cycle Hold time + Single Conversion + 2.5V Ref + RefON + ADC ON + Interrupts off + (Enable + Start)
-	ADC12CTL1 &= ~(SHS1 + SHS0 + ISSH + ADC12DIV2 + ADC12DIV1 + ADC12DIV0 + ADC12SSEL1 + ADC12SSEL0 + CONSEQ1 + CONSEQ0); //ADC12CTL1 &= ~0x0FDE = ~0000 1101 1111 1110
-	ADC12MEM15 = 0;
-	ADC12MCTL15 |= (SREF0 + INCH3 + INCH1 + INCH0); //ADC12MCTL15 |= 0x1B = x001 1011 - Reference Select + Input Select
-	ADC12MCTL15 &= ~(SREF2 + SREF1 + INCH2); // ADC12MCTL15 &= ~0x64 = 0110 0100
-	ADC12IE &= ~0x8000; //Turn off IE and clear IFG
-	ADC12IFG &= ~0x8000;
+	vPWR_StartSupply();
+	vPWR_WaitSupply();
 
-	__delay_cycles(1000);
-
-	ADC12CTL1 |= (CSTARTADD3 + CSTARTADD2 + CSTARTADD1 + CSTARTADD0 + SHP); //ADC12CTL1 |= 0xF200 = 1111 0010 0000 000x - MEM15 + Internal OSC CLK + Single-Channel, Single-conversion
-	ADC12CTL0 |= ENC + ADC12SC; // Sampling and conversion start
-
-	while (!(ADC12IFG & 0x8000)); //End when something is written in. Can't sleep because we wanted to keep interrupts for users (not in core)
-
-	rt_volts = ADC12MEM15; //(0.5*Vin)/2.5V * 4095
-	ADC12IFG &= ~0x8000; //Unset IFG Flag
-	ADC12CTL0 &= ~ENC;
-	ADC12CTL0 &= ~(REFON + ADC12ON); // turn off A/D to save power
-
-	rt_volts = (rt_volts * 5) / 41;
-	return (rt_volts);
+	return (uiPWR_GetSupply());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -159,18 +167,16 @@ unsigned int unCORE_GetVoltage(void)
 //!   \param none
 //!   \sa core.h
 ///////////////////////////////////////////////////////////////////////////////
-vCORE_Send_ConfirmPKT()
+void vCORE_Send_ConfirmPKT(void)
 {
-	uint8 ucaMsg_Buff[MAXMSGLEN];
-
 	// Send confirm packet that we received message
-	ucaMsg_Buff[MSG_TYP_IDX] = CONFIRM_COMMAND;
-	ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE;
-	ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
-	ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+	g_ucaCOMM_Reply[MSG_TYP_IDX] = CONFIRM_COMMAND;
+	g_ucaCOMM_Reply[MSG_LEN_IDX] = SP_HEADERSIZE;
+	g_ucaCOMM_Reply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+	g_ucaCOMM_Reply[MSG_FLAGS_IDX] = 0;
 
 	// Send the message
-	vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+	vCOMM_SendMessage(g_ucaCOMM_Reply, g_ucaCOMM_Reply[MSG_LEN_IDX]);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -184,17 +190,134 @@ vCORE_Send_ConfirmPKT()
 ///////////////////////////////////////////////////////////////////////////////
 void vCORE_Send_ErrorMsg(uint8 ucErrMsg)
 {
-	uint8 ucaMsg_Buff[MAXMSGLEN];
-
 	// Send confirm packet that we received message
-	ucaMsg_Buff[MSG_TYP_IDX] = REPORT_ERROR;
-	ucaMsg_Buff[MSG_LEN_IDX] = 5;
-	ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
-	ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
-	ucaMsg_Buff[MSG_PAYLD_IDX] = ucErrMsg;
+	g_ucaCOMM_Reply[MSG_TYP_IDX] = REPORT_ERROR;
+	g_ucaCOMM_Reply[MSG_LEN_IDX] = 5;
+	g_ucaCOMM_Reply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+	g_ucaCOMM_Reply[MSG_FLAGS_IDX] = 0;
+	g_ucaCOMM_Reply[MSG_PAYLD_IDX] = ucErrMsg;
 
 	// Send the message
-	vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+	vCOMM_SendMessage(g_ucaCOMM_Reply, g_ucaCOMM_Reply[MSG_LEN_IDX]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Tells the CP that a REPORT_DATA is waiting
+//!
+//! Called by the application from a scheduler handler.  INT_PIN is only
+//! raised if the CP asked for it with INT_NOTIFY_BIT, otherwise the readings
+//! simply wait in the cache.  The CP fetches the report with a REQUEST_DATA,
+//! which lets go of INT_PIN, so it holds everything sampled until then.
+//!
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vCORE_PostReport(void)
+{
+	if (!g_ucCORE_NotifyMode)
+		return;
+
+	g_ucCORE_ReportPending = 1;
+	vCOMM_RaiseInt();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Builds the REPORT_DATA message
+//!
+//! The version byte of the request selects the format, see REPORT_DATA.
+//!
+//!   \param pucBuff, the message buffer
+//!   \param ucReqVersion, the version byte of the request
+//!   \param unTransducerReturn, the return of the last dispatch, not 0 sends REPORT_ERROR
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vCORE_BuildReport(uint8 *pucBuff, uint8 ucReqVersion, uint16 unTransducerReturn)
+{
+	// Stuff the header
+	pucBuff[MSG_TYP_IDX] = REPORT_DATA;
+
+	//unTransducerArray is an 'OK' message.
+	//If not = to 0 then error
+	if (unTransducerReturn != 0)
+		pucBuff[MSG_TYP_IDX] = REPORT_ERROR;
+
+	if (ucMain_ShutdownAllowed() == 1)
+		pucBuff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+	else
+		pucBuff[MSG_FLAGS_IDX] = 0;
+
+	// Load the message buffer with data.  The fetch function returns length
+	if (ucReqVersion >= SP_PACKEDDATA_VERSION) {
+		// The version tells the CP whether the water contents follow
+		pucBuff[MSG_VER_IDX] = (ucReqVersion >= SP_PACKEDVWC_VERSION) ? SP_PACKEDVWC_VERSION : SP_PACKEDDATA_VERSION;
+		pucBuff[MSG_LEN_IDX] = SP_HEADERSIZE + ucMain_FetchPackedData(&pucBuff[MSG_PAYLD_IDX], ucReqVersion);
+	}
+	else {
+		pucBuff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+		pucBuff[MSG_LEN_IDX] = SP_HEADERSIZE + ucMain_FetchData(&pucBuff[MSG_PAYLD_IDX]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Measures the transducers of a COMMAND_PKT
+//!
+//! Every transducer named in the command is collected first so the
+//! application can service them together, then they are dispatched one by
+//! one.  A burst the CP asked for with CMD_BURST_BIT is applied before
+//! anything is measured.  The CP link is idle until the next start
+//! condition, so MCLK is slow while the transducers run.
+//!
+//!   \param pucRequest, the COMMAND_PKT
+//!   \return the returns of the transducer functions OR'd, 0 if all succeeded
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiCORE_RunCommand(uint8 *pucRequest)
+{
+	uint16 unTransducerReturn; //The return parameter from the transducer function
+	uint16 uiTransducerMask; //The transducers named in the command
+	uint8 ucMsgBuffIdx;
+	uint8 ucCmdTransNum;
+	uint8 ucCmdParamLen;
+
+	unTransducerReturn = 0; //default return value to 0
+
+	// Collect the transducers and apply the parameters before anything is measured
+	uiTransducerMask = 0;
+	for (ucMsgBuffIdx = MSG_PAYLD_IDX; ucMsgBuffIdx < pucRequest[MSG_LEN_IDX];) {
+		ucCmdTransNum = pucRequest[ucMsgBuffIdx++];
+		ucCmdParamLen = pucRequest[ucMsgBuffIdx++];
+
+		if ((ucMsgBuffIdx + ucCmdParamLen) > pucRequest[MSG_LEN_IDX])
+			break;
+
+		if (pucRequest[MSG_FLAGS_IDX] & CMD_BURST_BIT)
+			vMain_ApplyParams(ucCmdTransNum, ucCmdParamLen, &pucRequest[ucMsgBuffIdx]);
+		ucMsgBuffIdx += ucCmdParamLen;
+
+		if (ucCmdTransNum < MAX_NUM_TRANSDUCERS)
+			uiTransducerMask |= (1 << ucCmdTransNum);
+	}
+
+	vPWR_SetProfile(PWR_PROFILE_SLOW);
+	vMain_PrepareDispatch(uiTransducerMask);
+
+	// Read through the length of the message and execute commands as they are read
+	for (ucMsgBuffIdx = MSG_PAYLD_IDX; ucMsgBuffIdx < pucRequest[MSG_LEN_IDX];) {
+		// Get the transducer number and the parameter length
+		ucCmdTransNum = pucRequest[ucMsgBuffIdx++];
+		ucCmdParamLen = pucRequest[ucMsgBuffIdx++];
+
+		// The parameters must be inside the message
+		if ((ucMsgBuffIdx + ucCmdParamLen) > pucRequest[MSG_LEN_IDX])
+			break;
+
+		// Dispatch to perform the task, the parameters are passed in place
+		unTransducerReturn |= uiMainDispatch(ucCmdTransNum, ucCmdParamLen, &pucRequest[ucMsgBuffIdx]);
+		ucMsgBuffIdx += ucCmdParamLen;
+	}
+
+	vPWR_SetProfile(PWR_PROFILE_FAST);
+
+	return unTransducerReturn;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -212,48 +335,59 @@ void vCORE_Send_ErrorMsg(uint8 ucErrMsg)
 void vCORE_Run(void)
 {
 	uint16 unTransducerReturn; //The return parameter from the transducer function
-	uint8 ucaMsg_Buff[MAXMSGLEN];
+	uint8 *pucRequest; //The message being handled, in place in the RX buffer
+	uint8 *pucReply; //The reply, built in the other half
 	uint8 ucMsgBuffIdx;
 	uint8 ucTransIdx;
 	uint8 ucCmdTransNum;
 	uint8 ucCmdParamLen;
-	uint8 ucParamCount;
-	uint8 ucParam[20];
 	uint8 ucCommState;
+	uint16 uiLogSeq; //The first sequence number of REQUEST_LOG
+	uint8 ucReportVersion; //The report format of a command with CMD_REPORT_BIT
+
+	// The receive path is idle while a message is handled, so the request is not volatile here
+	pucRequest = (uint8 *) g_ucaRXBuffer;
+	pucReply = g_ucaCOMM_Reply;
+
+	// Nothing has failed yet, REQUEST_DATA may be answered from the background samples before any command
+	unTransducerReturn = 0;
+	ucReportVersion = SP_DATAMESSAGE_VERSION;
+	g_ucCORE_ReportPending = 0;
+	g_ucCORE_NotifyMode = 0;
 
 	// First, tell the CP Board that we are ready for commands
-	ucaMsg_Buff[MSG_TYP_IDX] = ID_PKT;
-	ucaMsg_Buff[MSG_LEN_IDX] = 12;
-	ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
-	ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+	pucReply[MSG_TYP_IDX] = ID_PKT;
+	pucReply[MSG_LEN_IDX] = 12;
+	pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+	pucReply[MSG_FLAGS_IDX] = 0;
 
 	ucMsgBuffIdx = MSG_PAYLD_IDX;
 
 	// The unique SP identification number
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[0];
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[0] >> 8);
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[1];
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[1] >> 8);
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[2];
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[2] >> 8);
-	ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[3];
-	ucaMsg_Buff[ucMsgBuffIdx] = (uint8) (uiHID[3] >> 8);
+	pucReply[ucMsgBuffIdx++] = (uint8) uiHID[0];
+	pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[0] >> 8);
+	pucReply[ucMsgBuffIdx++] = (uint8) uiHID[1];
+	pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[1] >> 8);
+	pucReply[ucMsgBuffIdx++] = (uint8) uiHID[2];
+	pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[2] >> 8);
+	pucReply[ucMsgBuffIdx++] = (uint8) uiHID[3];
+	pucReply[ucMsgBuffIdx] = (uint8) (uiHID[3] >> 8);
 
 	if (unCORE_GetVoltage() < MIN_VOLTAGE)
 	{
 		ucMsgBuffIdx = MSG_PAYLD_IDX;
 
-		ucaMsg_Buff[MSG_TYP_IDX] = REPORT_ERROR;
-		ucaMsg_Buff[MSG_LEN_IDX] = 5;
-		ucaMsg_Buff[ucMsgBuffIdx++] = 0xBA;
-		ucaMsg_Buff[ucMsgBuffIdx] = 0xD1;
+		pucReply[MSG_TYP_IDX] = REPORT_ERROR;
+		pucReply[MSG_LEN_IDX] = 5;
+		pucReply[ucMsgBuffIdx++] = 0xBA;
+		pucReply[ucMsgBuffIdx] = 0xD1;
 	}
 
 	// Wait in deep sleep for the start of a message
 	ucCOMM_WaitForStartCondition();
 
 	// Send the message
-	vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+	vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 
 	// The primary execution loop
 	while (TRUE)
@@ -263,188 +397,232 @@ void vCORE_Run(void)
 		// then assume it was an event that triggered the wake up
 		if (ucCOMM_WaitForStartCondition() != 1) {
 
-			vMain_EventTrigger();
+			// Run the work the ISRs posted, it is sensor work so MCLK can be slow
+			vPWR_SetProfile(PWR_PROFILE_SLOW);
+			vSched_Run();
+			vPWR_SetProfile(PWR_PROFILE_FAST);
 		}
 		else {
 
 			// Once we are awake, wait for a message from the CP
 			ucCOMM_WaitForMessage();
 
-			// Pull the message from the RX buffer and load it into a local buffer
-			ucCommState = ucCOMM_GrabMessageFromBuffer(ucaMsg_Buff);
+			// Check the message, it is handled where it was received
+			ucCommState = ucCOMM_CheckMessage();
 
 			if (ucCommState == COMM_OK) {
+				DIAG_BEGIN(DIAG_PHASE_TRANSACTION);
+
 				//Switch based on the message type
-				switch (ucaMsg_Buff[MSG_TYP_IDX])
+				switch (pucRequest[MSG_TYP_IDX])
 				{
 					case COMMAND_PKT:
 						// Send a confirmation packet
 					vCORE_Send_ConfirmPKT();
 
-						unTransducerReturn = 0; //default return value to 0
-
-						// Read through the length of the message and execute commands as they are read
-						for (ucMsgBuffIdx = MSG_PAYLD_IDX; ucMsgBuffIdx < ucaMsg_Buff[MSG_LEN_IDX];) {
-							// Get the transducer number and the parameter length
-							ucCmdTransNum = ucaMsg_Buff[ucMsgBuffIdx++];
-							ucCmdParamLen = ucaMsg_Buff[ucMsgBuffIdx++];
-
-							for (ucParamCount = 0; ucParamCount < ucCmdParamLen; ucParamCount++) {
-								ucParam[ucParamCount] = ucaMsg_Buff[ucMsgBuffIdx++];
+						unTransducerReturn = uiCORE_RunCommand(pucRequest);
+
+						// Push the report in the same session instead of waiting for a REQUEST_DATA
+						if (pucRequest[MSG_FLAGS_IDX] & CMD_REPORT_BIT) {
+							ucReportVersion = pucRequest[MSG_VER_IDX];
+							vCOMM_RaiseInt();
+
+							// The wait is bounded, the background work of the other wake ups still runs
+							vSched_StartTimer(SCHED_CORE_TIMER, CORE_REPORT_WAIT_S, SCHED_CORE_EVT);
+							while (TRUE) {
+								if (ucCOMM_WaitForStartCondition() == 1) {
+									vCOMM_ReleaseInt();
+
+									// A posted report goes out with this one
+									g_ucCORE_ReportPending = 0;
+
+									// Built now, so it holds what was sampled while waiting
+									pucReply[MSG_FLAGS_IDX] = 0;
+									vCORE_BuildReport(pucReply, ucReportVersion, unTransducerReturn);
+									vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
+									break;
+								}
+
+								vPWR_SetProfile(PWR_PROFILE_SLOW);
+								vSched_Run();
+								vPWR_SetProfile(PWR_PROFILE_FAST);
+
+								// Nobody came, the readings stay for a REQUEST_DATA
+								if (ucSched_TakeExpired(1 << SCHED_CORE_TIMER)) {
+									if (!g_ucCORE_ReportPending)
+										vCOMM_ReleaseInt();
+									break;
+								}
 							}
-
-							// Dispatch to perform the task, pass all values needed to populate the data
-							unTransducerReturn |= uiMainDispatch(ucCmdTransNum, ucCmdParamLen, ucParam);
+							vSched_StartTimer(SCHED_CORE_TIMER, 0, SCHED_CORE_EVT);
 						}
 					break; //END COMMAND_PKT
 
 					case REQUEST_DATA:
-						// Stuff the header
-						ucaMsg_Buff[MSG_TYP_IDX] = REPORT_DATA;
-
-						//unTransducerArray is an 'OK' message.
-						//If not = to 0 then error
-						if (unTransducerReturn != 0)
-							ucaMsg_Buff[MSG_TYP_IDX] = REPORT_ERROR;
-
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
-
-						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
-						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
-
-						// Load the message buffer with data.  The fetch function returns length
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE + ucMain_FetchData(&ucaMsg_Buff[MSG_PAYLD_IDX]);
+						// The version of the request selects the format of the reply, its flags are echoed
+						pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX];
+						vCORE_BuildReport(pucReply, pucRequest[MSG_VER_IDX], unTransducerReturn);
+
+						// This is the read INT_PIN was raised for
+						if (g_ucCORE_ReportPending) {
+							g_ucCORE_ReportPending = 0;
+							vCOMM_ReleaseInt();
+						}
 
 						// Send the message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 
 					break; //END REQUEST_DATA
 
 					case REQUEST_LABEL:
+#if COMM_SEGMENTED_ENABLED
+						// Every label, type and sample duration in one transfer
+						if (pucRequest[MSG_VER_IDX] >= SP_SEGMENTED_VERSION) {
+							if (ucMain_ShutdownAllowed() == 1)
+								pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
+							else
+								pucReply[MSG_FLAGS_IDX] = 0;
+
+							ucCOMM_SendSegmented(REQUEST_LABEL, pucReply[MSG_FLAGS_IDX], ucMain_FetchDescribeFrame, 0);
+							break;
+						}
+#endif
+
 						// Format first part of return message
-						ucaMsg_Buff[MSG_TYP_IDX] = REPORT_LABEL;
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE + TRANSDUCER_LABEL_LEN;
-						ucaMsg_Buff[MSG_VER_IDX] = SP_LABELMESSAGE_VERSION;
+						pucReply[MSG_TYP_IDX] = REPORT_LABEL;
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE + TRANSDUCER_LABEL_LEN;
+						pucReply[MSG_VER_IDX] = SP_LABELMESSAGE_VERSION;
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						// Make call to main for the trans. labels.  This way the core is not constrained to a fixed number of transducers
-						vMain_FetchLabel(ucaMsg_Buff[MSG_PAYLD_IDX], &ucaMsg_Buff[MSG_PAYLD_IDX]);
+						vMain_FetchLabel(pucRequest[MSG_PAYLD_IDX], &pucReply[MSG_PAYLD_IDX]);
 
 						// Send the label message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 					break; //END REQUEST_LABEL
 
 						//Report the BSL password to the CP
 					case REQUEST_BSL_PW:
 
 						// Stuff the header
-						ucaMsg_Buff[MSG_TYP_IDX] = REQUEST_BSL_PW;
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE + BSLPWDLEN; // BSL password is 32 bytes long
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+						pucReply[MSG_TYP_IDX] = REQUEST_BSL_PW;
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE + BSLPWDLEN; // BSL password is 32 bytes long
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						//go to the flash.c file to read the value in the 0xFFE0 to 0xFFFF
-						vFlash_GetBSLPW(&ucaMsg_Buff[MSG_PAYLD_IDX]);
+						vFlash_GetBSLPW(&pucReply[MSG_PAYLD_IDX]);
 
 						//once the password is obtained send it to the CP
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 					break;
 
 						// The CP requests sensor and board information from the SP
 					case INTERROGATE:
-						ucaMsg_Buff[MSG_TYP_IDX] = INTERROGATE;
-						ucaMsg_Buff[MSG_LEN_IDX] = 2 * ucMain_getNumTransducers() + 13; // 2 bytes for each sensor + header and ID packet length
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+#if COMM_SEGMENTED_ENABLED
+						// The same transfer as a segmented REQUEST_LABEL
+						if (pucRequest[MSG_VER_IDX] >= SP_SEGMENTED_VERSION) {
+							if (ucMain_ShutdownAllowed() == 1)
+								pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
+							else
+								pucReply[MSG_FLAGS_IDX] = 0;
+
+							ucCOMM_SendSegmented(INTERROGATE, pucReply[MSG_FLAGS_IDX], ucMain_FetchDescribeFrame, 0);
+							break;
+						}
+#endif
+
+						pucReply[MSG_TYP_IDX] = INTERROGATE;
+						pucReply[MSG_LEN_IDX] = 2 * ucMain_getNumTransducers() + 13; // 2 bytes for each sensor + header and ID packet length
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						ucMsgBuffIdx = MSG_PAYLD_IDX;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ucMain_getNumTransducers(); // Number of transducers attached
+						pucReply[ucMsgBuffIdx++] = ucMain_getNumTransducers(); // Number of transducers attached
 
 						// Loop through the number of sensors and fetch the sensor type and sample duration
 						for (ucTransIdx = 1; ucTransIdx <= ucMain_getNumTransducers(); ucTransIdx++) {
-							ucaMsg_Buff[ucMsgBuffIdx++] = ucMain_getTransducerType(ucTransIdx);
-							ucaMsg_Buff[ucMsgBuffIdx++] = ucMain_getSampleDuration(ucTransIdx);
+							pucReply[ucMsgBuffIdx++] = ucMain_getTransducerType(ucTransIdx);
+							pucReply[ucMsgBuffIdx++] = ucMain_getSampleDuration(ucTransIdx);
 						}
 
 						// Load the board name into the message buffer
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_HI_BYTE1;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_LO_BYTE1;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_HI_BYTE2;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_LO_BYTE2;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_HI_BYTE3;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_LO_BYTE3;
-						ucaMsg_Buff[ucMsgBuffIdx++] = ID_PKT_HI_BYTE4;
-						ucaMsg_Buff[ucMsgBuffIdx] = ID_PKT_LO_BYTE4;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_HI_BYTE1;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_LO_BYTE1;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_HI_BYTE2;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_LO_BYTE2;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_HI_BYTE3;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_LO_BYTE3;
+						pucReply[ucMsgBuffIdx++] = ID_PKT_HI_BYTE4;
+						pucReply[ucMsgBuffIdx] = ID_PKT_LO_BYTE4;
 
 						// Send the message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 					break;
 
 					case SET_SERIALNUM:
 
 						ucMsgBuffIdx = MSG_PAYLD_IDX;
-						uiHID[0] = (uint16) ucaMsg_Buff[ucMsgBuffIdx++];
-						uiHID[0] = uiHID[0] | (uint16) (ucaMsg_Buff[ucMsgBuffIdx++] << 8);
+						uiHID[0] = (uint16) pucRequest[ucMsgBuffIdx++];
+						uiHID[0] = uiHID[0] | (uint16) (pucRequest[ucMsgBuffIdx++] << 8);
 
-						uiHID[1] = (uint16) ucaMsg_Buff[ucMsgBuffIdx++];
-						uiHID[1] = uiHID[1] | (uint16) (ucaMsg_Buff[ucMsgBuffIdx++] << 8);
+						uiHID[1] = (uint16) pucRequest[ucMsgBuffIdx++];
+						uiHID[1] = uiHID[1] | (uint16) (pucRequest[ucMsgBuffIdx++] << 8);
 
-						uiHID[2] = (uint16) ucaMsg_Buff[ucMsgBuffIdx++];
-						uiHID[2] = uiHID[2] | (uint16) (ucaMsg_Buff[ucMsgBuffIdx++] << 8);
+						uiHID[2] = (uint16) pucRequest[ucMsgBuffIdx++];
+						uiHID[2] = uiHID[2] | (uint16) (pucRequest[ucMsgBuffIdx++] << 8);
 
-						uiHID[3] = (uint16) ucaMsg_Buff[ucMsgBuffIdx++];
-						uiHID[3] = uiHID[3] | (uint16) (ucaMsg_Buff[ucMsgBuffIdx] << 8);
+						uiHID[3] = (uint16) pucRequest[ucMsgBuffIdx++];
+						uiHID[3] = uiHID[3] | (uint16) (pucRequest[ucMsgBuffIdx] << 8);
 
 						// Write the message header assuming success
-						ucaMsg_Buff[MSG_TYP_IDX] = SET_SERIALNUM;
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE + 8;
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+						pucReply[MSG_TYP_IDX] = SET_SERIALNUM;
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE + 8;
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						// Write the new HID to flash
-						if (ucFlash_SetHID(uiHID)) {
+						if (ucConfig_Write(CONFIG_KEY_HID, uiHID, 4)) {
 							// Report an error if the write was unsuccessful
-							ucaMsg_Buff[MSG_TYP_IDX] = REPORT_ERROR;
-							ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE;
+							pucReply[MSG_TYP_IDX] = REPORT_ERROR;
+							pucReply[MSG_LEN_IDX] = SP_HEADERSIZE;
 
 						}
 						else {
-							// Get the SPs serial number from flash
-							vFlash_GetHID(uiHID);
+							// Get the SPs serial number back from the config store
+							ucConfig_Read(CONFIG_KEY_HID, uiHID, 4);
 
 							ucMsgBuffIdx = MSG_PAYLD_IDX;
 
 							// Write the new HID to the message buffer
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[0];
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[0] >> 8);
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[1];
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[1] >> 8);
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[2];
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) (uiHID[2] >> 8);
-							ucaMsg_Buff[ucMsgBuffIdx++] = (uint8) uiHID[3];
-							ucaMsg_Buff[ucMsgBuffIdx] = (uint8) (uiHID[3] >> 8);
+							pucReply[ucMsgBuffIdx++] = (uint8) uiHID[0];
+							pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[0] >> 8);
+							pucReply[ucMsgBuffIdx++] = (uint8) uiHID[1];
+							pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[1] >> 8);
+							pucReply[ucMsgBuffIdx++] = (uint8) uiHID[2];
+							pucReply[ucMsgBuffIdx++] = (uint8) (uiHID[2] >> 8);
+							pucReply[ucMsgBuffIdx++] = (uint8) uiHID[3];
+							pucReply[ucMsgBuffIdx] = (uint8) (uiHID[3] >> 8);
 						}
 
 						// Send the message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 
 					break;
 
@@ -469,14 +647,14 @@ void vCORE_Run(void)
 						uint8 ucSensorCount = 0;
 
 						// Format first part of return message
-						ucaMsg_Buff[MSG_TYP_IDX] = 0x0D;
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE + 2;
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+						pucReply[MSG_TYP_IDX] = 0x0D;
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE + 2;
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						// Loop through sensors and place types on msg buffer
 						for (ucSensorCount = 1; ucSensorCount < 5; ucSensorCount++) {
@@ -489,29 +667,126 @@ void vCORE_Run(void)
 
 						// put sensor types on buffer
 						for (ucSensorCount = 0; ucSensorCount < 4; ucSensorCount++) {
-							ucaMsg_Buff[ucSensorCount + SP_HEADERSIZE] = ucSensorTypes[ucSensorCount];
+							pucReply[ucSensorCount + SP_HEADERSIZE] = ucSensorTypes[ucSensorCount];
 						}
 
 						// Send the sensor types message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 					}
 					break;
 
+						// The CP sets how often the transducers are sampled in the background
+					case SET_SAMPLE_INTERVAL:
+						ucCommState = COMM_OK;
+
+						// Each entry is the transducer number and the interval in seconds, low byte first
+						for (ucMsgBuffIdx = MSG_PAYLD_IDX; (ucMsgBuffIdx + 3) <= pucRequest[MSG_LEN_IDX]; ucMsgBuffIdx += 3) {
+							if (ucMain_SetSampleInterval(pucRequest[ucMsgBuffIdx],
+									(uint16) pucRequest[ucMsgBuffIdx + 1] | ((uint16) pucRequest[ucMsgBuffIdx + 2] << 8)))
+								ucCommState = COMM_ERROR;
+						}
+
+						if (ucCommState == COMM_OK)
+							vCORE_Send_ConfirmPKT();
+						else
+							vCORE_Send_ErrorMsg(PACKET_ERROR_CODE);
+					break;
+
+						// The CP sets the thresholds the background samples are checked against
+					case SET_THRESHOLD:
+						ucCommState = COMM_OK;
+
+						// Each entry is the transducer number, the threshold and the hysteresis, low bytes first
+						for (ucMsgBuffIdx = MSG_PAYLD_IDX; (ucMsgBuffIdx + 5) <= pucRequest[MSG_LEN_IDX]; ucMsgBuffIdx += 5) {
+							if (ucMain_SetThreshold(pucRequest[ucMsgBuffIdx],
+									(int16) ((uint16) pucRequest[ucMsgBuffIdx + 1] | ((uint16) pucRequest[ucMsgBuffIdx + 2] << 8)),
+									(uint16) pucRequest[ucMsgBuffIdx + 3] | ((uint16) pucRequest[ucMsgBuffIdx + 4] << 8)))
+								ucCommState = COMM_ERROR;
+						}
+
+						if (ucCommState == COMM_OK) {
+							// The CP opts in to INT_PIN, every SET_THRESHOLD sets the mode again
+							g_ucCORE_NotifyMode = pucRequest[MSG_FLAGS_IDX] & INT_NOTIFY_BIT;
+							if (!g_ucCORE_NotifyMode && g_ucCORE_ReportPending) {
+								g_ucCORE_ReportPending = 0;
+								vCOMM_ReleaseInt();
+							}
+
+							vCORE_Send_ConfirmPKT();
+						}
+						else
+							vCORE_Send_ErrorMsg(PACKET_ERROR_CODE);
+					break;
+
+					case REQUEST_LOG:
+						if (pucRequest[MSG_LEN_IDX] < (SP_HEADERSIZE + 2)) {
+							vCORE_Send_ErrorMsg(PACKET_ERROR_CODE);
+							break;
+						}
+
+						uiLogSeq = (uint16) pucRequest[MSG_PAYLD_IDX] | ((uint16) pucRequest[MSG_PAYLD_IDX + 1] << 8);
+
+						if (ucMain_ShutdownAllowed() == 1)
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
+						else
+							pucReply[MSG_FLAGS_IDX] = 0;
+
+#if COMM_SEGMENTED_ENABLED
+						// All the records from there on in one transfer
+						if (pucRequest[MSG_VER_IDX] >= SP_SEGMENTED_VERSION) {
+							ucCOMM_SendSegmented(REQUEST_LOG, pucReply[MSG_FLAGS_IDX], ucLog_FetchFrame, uiLogSeq);
+							break;
+						}
+#endif
+
+						// Reply with the records from the requested sequence number on
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE + ucLog_Fetch(uiLogSeq, &pucReply[MSG_PAYLD_IDX]);
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
+					break;
+
+#if DIAG_ENABLED
+					case REQUEST_DIAG:
+						ucCmdTransNum = (pucRequest[MSG_LEN_IDX] > SP_HEADERSIZE) ? pucRequest[MSG_PAYLD_IDX] : 0;
+						ucCmdParamLen = (pucRequest[MSG_LEN_IDX] > (SP_HEADERSIZE + 1)) ? pucRequest[MSG_PAYLD_IDX + 1] : 0;
+
+						// The statistics of the core followed by the health of the transducers
+						ucMsgBuffIdx = MSG_PAYLD_IDX + ucDiag_Fetch(ucCmdTransNum, &pucReply[MSG_PAYLD_IDX]);
+						ucMsgBuffIdx += ucMain_FetchHealth(&pucReply[ucMsgBuffIdx]);
+						pucReply[MSG_LEN_IDX] = ucMsgBuffIdx;
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION;
+
+						if (ucMain_ShutdownAllowed() == 1)
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
+						else
+							pucReply[MSG_FLAGS_IDX] = 0;
+
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
+
+						// Start a new profile if asked to
+						if (ucCmdParamLen == 1)
+							vDiag_Clear();
+					break;
+#endif
+
 					default:
-						ucaMsg_Buff[MSG_TYP_IDX] = REPORT_ERROR;
-						ucaMsg_Buff[MSG_LEN_IDX] = SP_HEADERSIZE;
-						ucaMsg_Buff[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION; //-scb
+						pucReply[MSG_TYP_IDX] = REPORT_ERROR;
+						pucReply[MSG_LEN_IDX] = SP_HEADERSIZE;
+						pucReply[MSG_VER_IDX] = SP_DATAMESSAGE_VERSION; //-scb
 
 						if (ucMain_ShutdownAllowed() == 1)
-							ucaMsg_Buff[MSG_FLAGS_IDX] |= SHUTDOWN_BIT;
+							pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX] | SHUTDOWN_BIT;
 						else
-							ucaMsg_Buff[MSG_FLAGS_IDX] = 0;
+							pucReply[MSG_FLAGS_IDX] = 0;
 
 						// Send the message
-						vCOMM_SendMessage(ucaMsg_Buff, ucaMsg_Buff[MSG_LEN_IDX]);
+						vCOMM_SendMessage(pucReply, pucReply[MSG_LEN_IDX]);
 
 					break; //END default
 				} // END: switch(ucMsgType)
+
+				DIAG_END(DIAG_PHASE_TRANSACTION);
 			}
 			else {
 				vCORE_Send_ErrorMsg(ucCommState);
@@ -56,6 +56,11 @@
   //! \brief This error code is sent to the CP if the packet type is not recognized
   #define PACKET_ERROR_CODE	   0xF1
 
+  //! \def CORE_REPORT_WAIT_S
+  //! \brief How long a pushed REPORT_DATA waits for the start condition of the CP,
+  //! in scheduler ticks of one second, the first tick may come early
+  #define CORE_REPORT_WAIT_S	   2
+
   //! @}
 
   // Size typedefs
@@ -63,6 +68,18 @@
   //! These typedefs are used for the entire core and wrapper. This makes
   //! porting code easier and variable types faster to write.
   //! @{
+#ifdef SP_HOST_BUILD
+  // The host tests in host/ keep the MSP430 widths on a 32 or 64 bit PC
+  #include <stdint.h>
+  typedef uint8_t  uint8;
+  typedef int8_t   int8;
+
+  typedef uint16_t uint16;
+  typedef int16_t  int16;
+
+  typedef uint32_t uint32;
+  typedef int32_t  int32;
+#else
   typedef unsigned char uint8;
   typedef signed   char int8;
 
@@ -71,6 +88,7 @@
 
   typedef unsigned long uint32;
   typedef signed   long int32;
+#endif
 
   unsigned int uiCORE_GetVoltage(void);
 
@@ -80,13 +98,27 @@
   void vCORE_Initilize(void);
   void vCORE_InitilizeTransducerTable(void); //Now also sets functions from header
   void vCORE_Run(void);
+  void vCORE_PostReport(void);
+  //! @}
+
+  //! @name Message Functions
+  //! The work of vCORE_Run() for a COMMAND_PKT and a REQUEST_DATA.
+  //! @{
+  void vCORE_Send_ConfirmPKT(void);
+  uint16 uiCORE_RunCommand(uint8 *pucRequest);
+  void vCORE_BuildReport(uint8 *pucBuff, uint8 ucReqVersion, uint16 unTransducerReturn);
   //! @}
 
   // Core modules to include
+  #include "diag.h"
   #include "comm/msg.h"
   #include "comm/comm.h"
   #include "changeable_core_header.h"
   #include "flash.h"
+  #include "config.h"
+  #include "log.h"
+  #include "power.h"
+  #include "sched.h"
 
 
 #endif /*CORE_H_*/
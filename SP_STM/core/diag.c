@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file diag.c
+//! \brief This module times the phases of a transaction and counts errors
+//!
+//! The statistics are kept in RAM and read by the CP with REQUEST_DIAG, so a
+//! node can be profiled in the field without a debugger.  Times are in ticks
+//! of SMCLK (0.25us), energy follows from the time and the known current of
+//! each phase.
+//!
+//! @addtogroup core
+//! @{
+//!
+
+#include <msp430F235.h>
+#include "core.h"
+
+#if DIAG_ENABLED
+
+//******************  Diagnostics Variables  ********************************//
+//! @name Diagnostics Variables
+//! @{
+//! \var g_saDiag_Phase
+//! \brief Timing of each phase
+S_DiagPhase g_saDiag_Phase[DIAG_NUM_PHASES];
+
+//! \var g_ulaDiag_Start
+//! \brief Tick each phase was last started at
+uint32 g_ulaDiag_Start[DIAG_NUM_PHASES];
+
+//! \var g_uiaDiag_Count
+//! \brief The event counters
+uint16 g_uiaDiag_Count[DIAG_NUM_COUNTERS];
+
+//! \var g_uiDiag_Overflows
+//! \brief High word of the tick, counted in TIMERB1_ISR
+volatile uint16 g_uiDiag_Overflows;
+
+//! \var g_uiaDiag_StackGuard
+//! \brief Painted RAM right below the stack, only written by an overrun
+#pragma DATA_SECTION(g_uiaDiag_StackGuard, ".stackguard")
+uint16 g_uiaDiag_StackGuard[DIAG_STACK_GUARD / 2];
+//! @}
+
+//! @name Linker Symbols
+//! The addresses of these are the top and the length of .stack
+//! @{
+extern uint16 _STACK_END;
+extern uint16 _STACK_SIZE;
+//! @}
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Clears the statistics and starts the clock
+//!
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_Init(void)
+{
+	vDiag_Clear();
+	vDiag_StartClock();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Clears the statistics, the clock keeps running
+//!
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_Clear(void)
+{
+	uint8 ucIdx;
+
+	for (ucIdx = 0; ucIdx < DIAG_NUM_PHASES; ucIdx++)
+	{
+		g_saDiag_Phase[ucIdx].m_ulLast = 0;
+		g_saDiag_Phase[ucIdx].m_ulMin = 0xFFFFFFFF;
+		g_saDiag_Phase[ucIdx].m_ulMax = 0;
+		g_saDiag_Phase[ucIdx].m_uiCount = 0;
+	}
+
+	for (ucIdx = 0; ucIdx < DIAG_NUM_COUNTERS; ucIdx++)
+		g_uiaDiag_Count[ucIdx] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Starts TimerB free running from SMCLK
+//!
+//! Has to be called again by anything that borrows TimerB, such as the VLO
+//! calibration.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_StartClock(void)
+{
+	TBCTL = (TBSSEL_2 | TBCLR);
+	TBCTL |= (MC_2 | TBIE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the 32 bit tick
+//!
+//! An overflow that TIMERB1_ISR has not counted yet is added here, so the
+//! tick never runs backwards.
+//!   \param none
+//!   \return The tick
+///////////////////////////////////////////////////////////////////////////////
+uint32 ulDiag_Tick(void)
+{
+	uint16 uiHi;
+	uint16 uiLo;
+
+	__disable_interrupt();
+	uiHi = g_uiDiag_Overflows;
+	uiLo = TBR;
+	if ((TBCTL & TBIFG) && (uiLo < 0x8000))
+		uiHi++;
+	__enable_interrupt();
+
+	return ((uint32) uiHi << 16) | uiLo;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Marks the start of a phase
+//!
+//!   \param ucPhase, one of the DIAG_PHASE defines
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_Begin(uint8 ucPhase)
+{
+	g_ulaDiag_Start[ucPhase] = ulDiag_Tick();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Marks the end of a phase started with vDiag_Begin()
+//!
+//!   \param ucPhase, one of the DIAG_PHASE defines
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_End(uint8 ucPhase)
+{
+	vDiag_Record(ucPhase, ulDiag_Tick() - g_ulaDiag_Start[ucPhase]);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Adds the time of one run to a phase
+//!
+//! Safe to call from an ISR for a phase only timed there.
+//!   \param ucPhase, one of the DIAG_PHASE defines
+//!   \param ulTicks, the time taken
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_Record(uint8 ucPhase, uint32 ulTicks)
+{
+	S_DiagPhase *psPhase;
+
+	psPhase = &g_saDiag_Phase[ucPhase];
+
+	psPhase->m_ulLast = ulTicks;
+	if (ulTicks < psPhase->m_ulMin)
+		psPhase->m_ulMin = ulTicks;
+	if (ulTicks > psPhase->m_ulMax)
+		psPhase->m_ulMax = ulTicks;
+	if (psPhase->m_uiCount != 0xFFFF)
+		psPhase->m_uiCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Copies the statistics of a phase into a reply payload
+//!
+//! The payload is the phase, the number of phases, the counters, then the
+//! count, last, min and max of the phase, then the stack high-water mark and
+//! the stack size in bytes.  All values are low byte first.
+//!
+//! \param ucPhase, the phase to report
+//! \param pucBuff, the payload of the reply
+//! \return The length of the payload, DIAG_REPLY_LENGTH
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucDiag_Fetch(uint8 ucPhase, uint8 *pucBuff)
+{
+	uint8 ucIdx;
+	uint8 ucByte;
+	uint32 ulaValue[3];
+	uint16 uiPeak;
+	S_DiagPhase *psPhase;
+
+	if (ucPhase >= DIAG_NUM_PHASES)
+		ucPhase = 0;
+
+	psPhase = &g_saDiag_Phase[ucPhase];
+
+	*pucBuff++ = ucPhase;
+	*pucBuff++ = DIAG_NUM_PHASES;
+
+	for (ucIdx = 0; ucIdx < DIAG_NUM_COUNTERS; ucIdx++)
+	{
+		*pucBuff++ = (uint8) g_uiaDiag_Count[ucIdx];
+		*pucBuff++ = (uint8) (g_uiaDiag_Count[ucIdx] >> 8);
+	}
+
+	*pucBuff++ = (uint8) psPhase->m_uiCount;
+	*pucBuff++ = (uint8) (psPhase->m_uiCount >> 8);
+
+	ulaValue[0] = psPhase->m_ulLast;
+	ulaValue[1] = psPhase->m_uiCount ? psPhase->m_ulMin : 0;
+	ulaValue[2] = psPhase->m_ulMax;
+
+	for (ucIdx = 0; ucIdx < 3; ucIdx++)
+	{
+		for (ucByte = 0; ucByte < 4; ucByte++)
+		{
+			*pucBuff++ = (uint8) ulaValue[ucIdx];
+			ulaValue[ucIdx] >>= 8;
+		}
+	}
+
+	uiPeak = uiDiag_StackPeak();
+	*pucBuff++ = (uint8) uiPeak;
+	*pucBuff++ = (uint8) (uiPeak >> 8);
+	*pucBuff++ = (uint8) ((uint16) &_STACK_SIZE);
+	*pucBuff++ = (uint8) ((uint16) &_STACK_SIZE >> 8);
+
+	return DIAG_REPLY_LENGTH;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Paints the guard and the free part of the stack
+//!
+//! Called once at boot, before the stack has been deep.  Only the words
+//! below the stack pointer are painted, they are not in use.
+//!
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vDiag_PaintStack(void)
+{
+	uint16 *puiWord;
+
+	for (puiWord = g_uiaDiag_StackGuard; (uint16) puiWord < __get_SP_register(); puiWord++)
+		*puiWord = DIAG_STACK_PAINT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Finds the deepest the stack has been since boot
+//!
+//! More than the stack size means the guard was written.  If the whole guard
+//! lost its paint the stack may have gone deeper than reported.
+//!
+//!   \param none
+//!   \return The high-water mark in bytes from the top of the stack
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiDiag_StackPeak(void)
+{
+	uint16 *puiWord;
+
+	puiWord = g_uiaDiag_StackGuard;
+	while ((puiWord < &_STACK_END) && (*puiWord == DIAG_STACK_PAINT))
+		puiWord++;
+
+	return (uint16) &_STACK_END - (uint16) puiWord;
+}
+
+#endif // DIAG_ENABLED
+
+//! @}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file diag.h
+//! \brief Header file for the diagnostics module
+//!
+//!
+//! @addtogroup core
+//! @{
+
+#ifndef DIAG_H_
+#define DIAG_H_
+
+//! \def DIAG_ENABLED
+//! \brief Build in the phase timing and error counters
+//!
+//! With this set TimerB free runs from SMCLK with its overflow counted in
+//! TIMERB1_ISR, so g_uiDiag_Overflows and TBR form a 32 bit tick of 0.25us.
+//! The clock stops while the CPU is in LPM3, phases are only timed while awake.
+#define DIAG_ENABLED		1
+
+//! @name Phases
+//! The phases of a transaction that are timed
+//! @{
+#define DIAG_PHASE_STM_SETTLE		0	//!< STM powered until the level shifter delay is over
+#define DIAG_PHASE_STM_RECEIVE		1	//!< Waiting for the 1200 baud frame(s)
+#define DIAG_PHASE_STM_PARSE		2	//!< One byte through the frame parser and checksum (in the ISR)
+#define DIAG_PHASE_COMM_SEND		3	//!< vCOMM_SendMessage, the running CRC included
+#define DIAG_PHASE_TRANSACTION		4	//!< A CP message grabbed until its reply is sent
+#define DIAG_NUM_PHASES				5
+//! @}
+
+//! @name Counters
+//! Event counters, they stop at 0xFFFF
+//! @{
+#define DIAG_CNT_STM_CHECKSUM		0	//!< STM_ERROR_CODE_1 results
+#define DIAG_CNT_STM_TIMEOUT		1	//!< STM_ERROR_CODE_2 results
+#define DIAG_CNT_COMM_PARITY		2	//!< COMM_PARITY_ERR on a received byte
+#define DIAG_CNT_COMM_RETRY			3	//!< Bytes resent by vCOMM_SendMessage, windows resent by ucCOMM_SendSegmented
+#define DIAG_NUM_COUNTERS			4
+//! @}
+
+//! \def DIAG_REPLY_LENGTH
+//! \brief Payload length of a REQUEST_DIAG reply
+#define DIAG_REPLY_LENGTH			(2 + 2 * DIAG_NUM_COUNTERS + 2 + 3 * 4 + 2 + 2)
+
+//! @name Stack Probe
+//! The stack and a guard below it are painted at boot, the deepest word that
+//! lost the paint is the high-water mark.  The guard is the .stackguard
+//! section, grouped right below .stack in lnk_msp430f235.cmd.
+//! @{
+#define DIAG_STACK_PAINT			0xA5A5	//!< Word painted over the free stack
+#define DIAG_STACK_GUARD			64		//!< Bytes painted below the stack to catch an overrun
+//! @}
+
+//! \struct S_DiagPhase
+//! \brief Timing of one phase in ticks
+typedef struct
+{
+	uint32 m_ulLast;			//!< The last time taken
+	uint32 m_ulMin;				//!< The shortest time taken
+	uint32 m_ulMax;				//!< The longest time taken
+	uint16 m_uiCount;			//!< Times the phase ran, stops at 0xFFFF
+} S_DiagPhase;
+
+#if DIAG_ENABLED
+//! @name Instrumentation Macros
+//! These compile to nothing when DIAG_ENABLED is 0
+//! @{
+#define DIAG_BEGIN(phase)			vDiag_Begin(phase)
+#define DIAG_END(phase)				vDiag_End(phase)
+#define DIAG_RECORD(phase, ticks)	vDiag_Record((phase), (ticks))
+#define DIAG_COUNT(counter)			{ if (g_uiaDiag_Count[counter] != 0xFFFF) g_uiaDiag_Count[counter]++; }
+//! @}
+
+extern uint16 g_uiaDiag_Count[DIAG_NUM_COUNTERS];
+extern volatile uint16 g_uiDiag_Overflows;
+#else
+#define DIAG_BEGIN(phase)
+#define DIAG_END(phase)
+#define DIAG_RECORD(phase, ticks)
+#define DIAG_COUNT(counter)
+#endif
+
+// diag.c function prototypes
+//! @name diag module Functions
+//! These functions time the phases and report the statistics
+//! @{
+void vDiag_Init(void);
+void vDiag_Clear(void);
+void vDiag_StartClock(void);
+uint32 ulDiag_Tick(void);
+void vDiag_Begin(uint8 ucPhase);
+void vDiag_End(uint8 ucPhase);
+void vDiag_Record(uint8 ucPhase, uint32 ulTicks);
+uint8 ucDiag_Fetch(uint8 ucPhase, uint8 *pucBuff);
+void vDiag_PaintStack(void);
+uint16 uiDiag_StackPeak(void);
+//! @}
+
+#endif /*DIAG_H_*/
+//! @}
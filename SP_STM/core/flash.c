@@ -33,8 +33,8 @@ void vFlash_init(void)
 
 	}
 
-	//SMCLK source, divider = 0x0A to get 400Khz Flash timing generator
-	FCTL2 = FWKEY + FSSEL0 + (FN1 | FN3);
+	//SMCLK source (4MHz), divider = 0x0A+1 to get ~364Khz Flash timing generator
+	FCTL2 = FWKEY + FSSEL1 + (FN1 | FN3);
 
 } //END: vFlash_init()
 
@@ -55,8 +55,6 @@ static uint8 ucFlash_Write_Byte(uint8 ucData, uint16 unAddress)
 
 	//clear the lock bits
 	FCTL3 = FWKEY;
-	//Set the erase bit
-	FCTL1 = FWKEY + ERASE;
 	//set the write bit
 	FCTL1 = FWKEY + WRT;
 
@@ -79,48 +77,49 @@ static uint8 ucFlash_Write_Byte(uint8 ucData, uint16 unAddress)
 	return 0;
 } //END: ucFlash_Write_Byte()
 
-//////////////////////////vFlash_Write_Byte()////////////////////////////////////
-//! \brief Writes the passed byte to flash in the provided address
-//!
-//! This function should not be called directly, it assumes vFlash_init() has already been called
+//////////////////////////ucFlash_Write_Ints()////////////////////////////////////
+//! \brief Writes a run of words to flash without erasing it first
 //!
+//! The words must have been erased (0xFFFF) or only have bits cleared.  This
+//! function assumes vFlash_init() has already been called.
 //!
-//! \param ucData
-//! \return success
+//! \param puiData, the words to write
+//! \param uiAddress, an even address in flash
+//! \param ucCount, the number of words
+//! \return 0 on success, 1 if the flash controller reported a failure
 //////////////////////////////////////////////////////////////////////////
-static uint8 ucFlash_Write_Int(uint16 uiData, uint16 uiAddress)
+uint8 ucFlash_Write_Ints(uint16 *puiData, uint16 uiAddress, uint8 ucCount)
 {
 	uint16 *uiFlashPtr;
+	uint8 ucFail;
+
 	//initialize the flash pointer to point to the given address
-	uiFlashPtr = (uint16 *)uiAddress;
+	uiFlashPtr = (uint16 *) uiAddress;
 
+	while (BUSY & FCTL3);
 	//clear the lock bits
 	FCTL3 = FWKEY;
-	//Set the erase bit
-	FCTL1 = FWKEY + ERASE;
 	//set the write bit
 	FCTL1 = FWKEY + WRT;
 
-	//wait statements prevent writing to flash while module is busy
-	while (!(FCTL3 & WAIT))
-		;
-	*uiFlashPtr = uiData;
-	while (!(FCTL3 & WAIT))
-		;
+	while (ucCount--)
+	{
+		//wait statements prevent writing to flash while module is busy
+		while (!(FCTL3 & WAIT));
+		*uiFlashPtr++ = *puiData++;
+	}
+	while (!(FCTL3 & WAIT));
+
+	// Access violation means the write was refused
+	ucFail = (FCTL3 & ACCVIFG) ? 1 : 0;
 
 	//clear the write bit
 	FCTL1 = FWKEY;
 	//set the lock bit
 	FCTL3 = FWKEY + LOCK;
 
-	//if the operation failed report it to the calling function
-	if ((FCTL3 & 0x80) == 0x9680)
-	{
-		return 1;
-	}
-
-	return 0;
-} //END: ucFlash_Write_Byte()
+	return ucFail;
+} //END: ucFlash_Write_Ints()
 
 //////////////////////////vFlash_Read_Byte()////////////////////////////////////
 //! \brief Reads a byte from flash at the provided address
@@ -139,104 +138,13 @@ static uint16 uiFlash_Read_Int(uint16 unAddress)
 	//initialize the flash pointer to point to the given address
 	unFlashPtr = (uint16 *) unAddress;
 
-	//clear the lock bits
-	FCTL3 = FWKEY;
-	//Set the erase bit
-	FCTL1 = FWKEY + ERASE;
-
-	//wait statements prevent writing to flash while module is busy
-	while (!(FCTL3 & WAIT));
+	// Reading needs no flash controller setup
 	unData = *unFlashPtr;
-	while (!(FCTL3 & WAIT));
-
-	//clear the write bit
-	FCTL1 = FWKEY;
-	//set the lock bit
-	FCTL3 = FWKEY + LOCK;
 
 	return (unData);
 
 } //END: vFlash_Read_Int()
 
-///////////////////////////////////////////////////////////////////////////
-//! \brief Reads a segment from flash at the provided address
-//!This function should not be called directly, it assumes vFlash_init() has already been called
-//! \param unAddress
-//! \return ucData
-/////////////////////////////////////////////////////////////////////////////
-void vFlash_Read_Segment(uint16 * uiData, uint16 uiAddress)
-{
-	uint16 *uiFlashPtr;;
-	uint16 uiIndex;
-	uint8 ucFlashSzInt;
-
-	// Number of integers in flash memory
-	ucFlashSzInt = INFO_SEGMENTLENGTH/2;
-
-	//initialize the flash pointer to point to the given address
-	uiFlashPtr = (uint16 *) uiAddress;
-
-	//clear the lock bits
-	FCTL3 = FWKEY;
-
-	// Loop through the segment and read out the data
-	for (uiIndex = 0; uiIndex < ucFlashSzInt; uiIndex++)
-	{
-		//wait statements prevent writing to flash while module is busy
-		while (!(FCTL3 & WAIT));
-		*uiData++ = *uiFlashPtr++;
-	}
-
-	//clear the write bit
-	FCTL1 = FWKEY;
-	//set the lock bit
-	FCTL3 = FWKEY + LOCK;
-
-} //END: vFlash_Read_Segment()
-
-///////////////////////////////////////////////////////////////////////////
-//! \brief Writes a segment of memory specified by the address.
-//!
-//!
-//! \param ucData, ulAddress
-//! \return success
-//////////////////////////////////////////////////////////////////////////
-static void vFlash_Write_Segment(uint16 * uiData, uint16 uiAddress)
-{
-	uint16 *uiFlashPtr;
-	uint16 uiIndex;
-	uint8 ucFlashSzInt;
-
-	// Number of integers in flash memory
-	ucFlashSzInt = INFO_SEGMENTLENGTH/2;
-
-	//initialize the flash pointer to point to the given address
-	uiFlashPtr = (uint16 *)uiAddress;
-
-	//clear the lock bits
-	FCTL3 = FWKEY;
-	//Set the erase bit
-	FCTL1 = FWKEY + ERASE;
-
-	//set the write bit
-	FCTL1 = FWKEY + WRT;
-
-	// Loop through the segment and write the data
-	for (uiIndex = 0; uiIndex < ucFlashSzInt; uiIndex++)
-	{
-		//wait statements prevent writing to flash while module is busy
-		while (!(FCTL3 & WAIT));
-		*uiFlashPtr++ = *uiData++;
-	}
-
-	//clear the write bit
-	FCTL1 = FWKEY;
-	//set the lock bit
-	FCTL3 = FWKEY + LOCK;
-
-} //END: ucFlash_Write_Segment()
-
-
 ////////////////////////// vFlash_Erase_Seg() ////////////////////////////////////
 //! \brief Erases a segment in Flash
 //!
@@ -257,6 +165,8 @@ void vFlash_Erase_Seg(uint16 unAddress)
 	FCTL1 = FWKEY + ERASE; // Set Erase bit
 	*unFlashPtr = 0; // Dummy write to erase Flash seg
 	while (BUSY & FCTL3); // Check if Erase is done
+	FCTL1 = FWKEY; // Clear Erase bit
+	FCTL3 = FWKEY + LOCK; // Set Lock bit
 }
 
 //////////////////////////vFlash_DisIncorrect_BSLPW_Erase()////////////////////////////////////
@@ -321,64 +231,5 @@ void vFlash_GetBSLPW(uint8 *p_ucBuff)
 	}
 } //END: vFlash_GetBSLPW()
 
-////////////////////////// ucFlash_SetHID() ////////////////////////////////////
-//! \brief Sets the hardware ID (HID) in flash.  The  HID is unique for every SP board and
-//! is set before deployment.
-//!
-//! \param ucSPID
-//! \return ucErrCode
-////////////////////////////////////////////////////////////////////////////////
-uint8 ucFlash_SetHID(uint16 *uiHID)
-{
-	uint8 ucErrCode;
-	uint16 uiSegmentData[INFO_SEGMENTLENGTH/2];
-	uint8 uiIndex;
-
-	// Assume success
-	ucErrCode = 0;
-
-	//initialize the flash controller
-	vFlash_init();
-
-	vFlash_Read_Segment(uiSegmentData, FLASH_INFO_D);
-
-	vFlash_Erase_Seg(FLASH_INFO_D);
-
-	for(uiIndex = 0; uiIndex < HID_ADDRESS + 4; uiIndex++)
-	{
-		uiSegmentData[uiIndex] = *uiHID++;
-	}
-
-	vFlash_Write_Segment(uiSegmentData, FLASH_INFO_D);
-
-	//if the operation failed report it to the calling function
-	if ((FCTL3 & 0x80) == 0x9680)
-	{
-		ucErrCode = 1;
-	}
-	return ucErrCode;
-}
-
-////////////////////////// ulFlash_GetHID() ////////////////////////////////////
-//! \brief Gets the hardware ID (HID) from flash.  The HID is unique for every SP board.
-//!
-//! \param *uiHID
-//! \return none
-//////////////////////////////////////////////////////////////////////////
-void vFlash_GetHID(uint16 *uiHID)
-{
- uint16 uiIndex;
-
-	//initialize the flash controller
-	vFlash_init();
-
-	// Read the HID from the segment
-	for (uiIndex = 0; uiIndex < 4; uiIndex++)
-	{
-		*uiHID++ = uiFlash_Read_Int(FLASH_INFO_D + HID_ADDRESS + uiIndex*2);
-	}
-
-}
-
 //! @}
 
@@ -42,17 +42,18 @@
 #define FLASH_INFO_D	0x1000
 
 //! \def HID_ADDRESS
-//! \brief The address in info memory sector D
+//! \brief The address in info memory sector D of the HID on boards set up before the config store
 #define HID_ADDRESS	0
 
 // flash.c function prototypes
 //! @name flash module Functions
 //! These functions handle controlling the on CPU flash memory module
 //! @{
+void vFlash_init(void);
+uint8 ucFlash_Write_Ints(uint16 *puiData, uint16 uiAddress, uint8 ucCount);
+void vFlash_Erase_Seg(uint16 unAddress);
 void vFlash_GetBSLPW(uint8 *p_ucBuff);
 void vFlash_DisIncorrect_BSLPW_Erase(void);
-void vFlash_GetHID(uint16 *uiHID);
-uint8 ucFlash_SetHID(uint16 *uiHID);
 //flash_dco_cal
 //! @}
 
@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file log.c
+//! \brief This module keeps a ring log of measurements in flash
+//!
+//! Every record is written once into erased flash, so logging a sample never
+//! costs a segment erase.  Records carry a 16 bit sequence number which the CP
+//! uses to pull whatever it has not seen yet with REQUEST_LOG.
+//!
+//! @addtogroup core
+//! @{
+//!
+
+#include <msp430F235.h>
+#include "core.h"
+#include "log.h"
+
+//******************  Log Variables  ****************************************//
+//! @name Log Variables
+//! The head is found again by vLog_Init() after every reset.
+//! @{
+//! \var uint16 g_uiLog_Head
+//! \brief The next record to write, always erased
+uint16 g_uiLog_Head;
+
+//! \var uint16 g_uiLog_NextSeq
+//! \brief The sequence number of the next record
+uint16 g_uiLog_NextSeq;
+//! @}
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the flash address of a record
+//!
+//! \param uiRecord, 0 to LOG_NUM_RECORDS - 1
+//! \return uint16 address
+///////////////////////////////////////////////////////////////////////////////
+static uint16 uiLog_Address(uint16 uiRecord)
+{
+	return LOG_START_ADDR + (uiRecord / LOG_RECORDS_PER_SEGMENT) * LOG_SEGMENT_LENGTH
+			+ (uiRecord % LOG_RECORDS_PER_SEGMENT) * LOG_RECORD_LENGTH;
+}
+
+//! \def puiLog_Record
+//! \brief Pointer to the words of a record
+#define puiLog_Record(uiRecord)		((uint16 *) uiLog_Address(uiRecord))
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Moves the head to the next record
+//!
+//! Entering a new segment erases it, it holds the oldest records.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vLog_Advance(void)
+{
+	if (++g_uiLog_Head >= LOG_NUM_RECORDS)
+		g_uiLog_Head = 0;
+
+	if ((g_uiLog_Head % LOG_RECORDS_PER_SEGMENT) == 0)
+	{
+		vFlash_init();
+		vFlash_Erase_Seg(uiLog_Address(g_uiLog_Head));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Finds the head of the log after a reset
+//!
+//! The head is the free record that follows a used one.  If no record is
+//! used the log starts at the beginning.  If no record is free (a reset hit
+//! between filling a segment and erasing the next one) the segment after
+//! the last one is erased.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vLog_Init(void)
+{
+	uint16 uiRecord;
+	uint16 uiPrev;
+	uint16 *puiRecord;
+
+	g_uiLog_Head = 0;
+	g_uiLog_NextSeq = 0;
+
+	uiPrev = LOG_NUM_RECORDS - 1;
+	for (uiRecord = 0; uiRecord < LOG_NUM_RECORDS; uiRecord++)
+	{
+		if ((puiLog_Record(uiRecord)[LOG_SEQ_WORD] == 0xFFFF) && (puiLog_Record(uiPrev)[LOG_SEQ_WORD] != 0xFFFF))
+			break;
+		uiPrev = uiRecord;
+	}
+
+	if (uiRecord < LOG_NUM_RECORDS)
+	{
+		g_uiLog_Head = uiRecord;
+	}
+	else if (puiLog_Record(0)[LOG_SEQ_WORD] != 0xFFFF)
+	{
+		// Full ring, restart at the first segment
+		g_uiLog_Head = LOG_NUM_RECORDS - 1;
+		vLog_Advance();
+	}
+
+	// Continue the sequence from the newest record that is not dead
+	uiRecord = g_uiLog_Head;
+	do
+	{
+		uiRecord = (uiRecord == 0) ? (LOG_NUM_RECORDS - 1) : (uiRecord - 1);
+		puiRecord = puiLog_Record(uiRecord);
+
+		if (puiRecord[LOG_SEQ_WORD] == 0xFFFF)
+			break;
+
+		if (puiRecord[LOG_ID_WORD] != 0)
+		{
+			g_uiLog_NextSeq = puiRecord[LOG_SEQ_WORD] + 1;
+			break;
+		}
+	}
+	while (uiRecord != g_uiLog_Head);
+
+	if (g_uiLog_NextSeq == 0xFFFF)
+		g_uiLog_NextSeq = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Appends a measurement to the log
+//!
+//! The sequence number goes in last so a record cut off by a reset is never
+//! taken as complete.  Such a record is marked dead and skipped.
+//!
+//! \param ucDataGen, the data generator (S_Report index)
+//! \param ucLength, number of data bytes, 1 to LOG_MAX_DATA_LEN
+//! \param ulTimestamp, the time the data was taken
+//! \param pucData, the data bytes
+//! \return 0 on success, 1 on a bad length or a failed flash write
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucLog_Append(uint8 ucDataGen, uint8 ucLength, uint32 ulTimestamp, uint8 *pucData)
+{
+	uint16 *puiRecord;
+	uint16 uiaRecord[LOG_RECORD_LENGTH / 2];
+	uint16 uiaDead[2];
+	uint8 ucaData[LOG_MAX_DATA_LEN];
+	uint8 ucIdx;
+
+	if ((ucLength == 0) || (ucLength > LOG_MAX_DATA_LEN))
+		return 1;
+
+	for (ucIdx = 0; ucIdx < LOG_MAX_DATA_LEN; ucIdx++)
+		ucaData[ucIdx] = (ucIdx < ucLength) ? pucData[ucIdx] : 0xFF;
+
+	uiaRecord[LOG_SEQ_WORD] = g_uiLog_NextSeq;
+	uiaRecord[LOG_ID_WORD] = (uint16) ucDataGen | ((uint16) ucLength << 8);
+	uiaRecord[LOG_TIME_LO_WORD] = (uint16) ulTimestamp;
+	uiaRecord[LOG_TIME_HI_WORD] = (uint16) (ulTimestamp >> 16);
+	uiaRecord[LOG_DATA_WORD] = (uint16) ucaData[0] | ((uint16) ucaData[1] << 8);
+	uiaRecord[LOG_DATA_WORD + 1] = (uint16) ucaData[2] | ((uint16) ucaData[3] << 8);
+
+	vFlash_init();
+
+	// Retire a record left half written by a reset
+	puiRecord = puiLog_Record(g_uiLog_Head);
+	for (ucIdx = LOG_ID_WORD; ucIdx < (LOG_RECORD_LENGTH / 2); ucIdx++)
+	{
+		if (puiRecord[ucIdx] != 0xFFFF)
+		{
+			uiaDead[0] = 0;
+			uiaDead[1] = 0;
+			ucFlash_Write_Ints(uiaDead, uiLog_Address(g_uiLog_Head), 2);
+			vLog_Advance();
+			break;
+		}
+	}
+
+	// Data first, then the sequence number commits the record
+	if (ucFlash_Write_Ints(&uiaRecord[LOG_ID_WORD], uiLog_Address(g_uiLog_Head) + 2 * LOG_ID_WORD, (LOG_RECORD_LENGTH / 2) - 1))
+		return 1;
+	if (ucFlash_Write_Ints(&uiaRecord[LOG_SEQ_WORD], uiLog_Address(g_uiLog_Head) + 2 * LOG_SEQ_WORD, 1))
+		return 1;
+
+	if (++g_uiLog_NextSeq == 0xFFFF)
+		g_uiLog_NextSeq = 0;
+
+	vLog_Advance();
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Copies the records from a sequence number on into a reply payload
+//!
+//! The payload is the sequence number of the first record (low byte first),
+//! the number of records, then per record the data generator, the length, the
+//! time stamp (4 bytes, low byte first) and LOG_MAX_DATA_LEN data bytes.  The
+//! records are consecutive, so only the first sequence number is sent.  If
+//! \e uiFromSeq is older than the log the reply starts at the oldest record.
+//!
+//! \param uiFromSeq, the first sequence number the CP wants
+//! \param pucBuff, the payload of the reply
+//! \return The length of the payload
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucLog_Fetch(uint16 uiFromSeq, uint8 *pucBuff)
+{
+	uint16 uiRecord;
+	uint16 uiCount;
+	uint16 *puiRecord;
+	uint8 ucRecords;
+	uint8 ucIdx;
+	uint8 *pucOut;
+
+	ucRecords = 0;
+	pucBuff[0] = (uint8) uiFromSeq;
+	pucBuff[1] = (uint8) (uiFromSeq >> 8);
+	pucOut = &pucBuff[3];
+
+	// The oldest record follows the head
+	uiRecord = g_uiLog_Head;
+	for (uiCount = 1; uiCount < LOG_NUM_RECORDS; uiCount++)
+	{
+		if (++uiRecord >= LOG_NUM_RECORDS)
+			uiRecord = 0;
+
+		puiRecord = puiLog_Record(uiRecord);
+
+		// Skip free and dead records and the ones the CP already has
+		if ((puiRecord[LOG_SEQ_WORD] == 0xFFFF) || (puiRecord[LOG_ID_WORD] == 0))
+			continue;
+		if ((int16) (puiRecord[LOG_SEQ_WORD] - uiFromSeq) < 0)
+			continue;
+
+		if (ucRecords == 0)
+		{
+			pucBuff[0] = (uint8) puiRecord[LOG_SEQ_WORD];
+			pucBuff[1] = (uint8) (puiRecord[LOG_SEQ_WORD] >> 8);
+		}
+
+		for (ucIdx = LOG_ID_WORD; ucIdx < (LOG_RECORD_LENGTH / 2); ucIdx++)
+		{
+			*pucOut++ = (uint8) puiRecord[ucIdx];
+			*pucOut++ = (uint8) (puiRecord[ucIdx] >> 8);
+		}
+
+		if (++ucRecords == LOG_RECORDS_PER_MSG)
+			break;
+	}
+
+	pucBuff[2] = ucRecords;
+
+	return 3 + ucRecords * LOG_WIRE_RECORD_LENGTH;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Fills one frame of a segmented REQUEST_LOG reply
+//!
+//! The frame is a ucLog_Fetch() payload.  The records in it are consecutive,
+//! so the next frame starts behind the last one.  A frame that is not full
+//! is the last.
+//!
+//! \param puiCursor, the first sequence number wanted, moved behind the frame
+//! \param pucBuff, the frame payload
+//! \param pucLast, set to 1 on the last frame
+//! \return The length of the payload
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucLog_FetchFrame(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast)
+{
+	uint8 ucLength;
+
+	ucLength = ucLog_Fetch(*puiCursor, pucBuff);
+
+	*puiCursor = ((uint16) pucBuff[0] | ((uint16) pucBuff[1] << 8)) + pucBuff[2];
+	*pucLast = (pucBuff[2] < LOG_RECORDS_PER_MSG) ? 1 : 0;
+
+	return ucLength;
+}
+
+//! @}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file log.h
+//! \brief Header file for the measurement log module
+//!
+//!
+//! @addtogroup core
+//! @{
+
+#ifndef LOG_H_
+#define LOG_H_
+
+//! @name Log Geometry
+//! The log is a ring of records in main flash, reserved through the LOG
+//! region of lnk_msp430f235.cmd.  Records are only ever appended to erased
+//! flash.  A segment is erased once, when the ring moves into it, so there
+//! is always at least one free record and the head can be found after a reset.
+//! @{
+//! \def LOG_START_ADDR
+//! \brief First address of the log, must match the LOG region in the linker command file
+#define LOG_START_ADDR			0xC000
+
+//! \def LOG_SEGMENT_LENGTH
+//! \brief Length of a main flash segment
+#define LOG_SEGMENT_LENGTH		512
+
+//! \def LOG_NUM_SEGMENTS
+//! \brief Number of segments in the ring
+#define LOG_NUM_SEGMENTS		4
+
+//! \def LOG_RECORD_LENGTH
+//! \brief Length of a record in flash (6 words)
+#define LOG_RECORD_LENGTH		12
+
+//! \def LOG_RECORDS_PER_SEGMENT
+//! \brief Records in one segment, records do not cross segments
+#define LOG_RECORDS_PER_SEGMENT	(LOG_SEGMENT_LENGTH / LOG_RECORD_LENGTH)
+
+//! \def LOG_NUM_RECORDS
+//! \brief Records in the ring
+#define LOG_NUM_RECORDS			(LOG_RECORDS_PER_SEGMENT * LOG_NUM_SEGMENTS)
+
+//! \def LOG_MAX_DATA_LEN
+//! \brief Data bytes in a record, the same as an S_Report entry
+#define LOG_MAX_DATA_LEN		4
+
+//! \def LOG_WIRE_RECORD_LENGTH
+//! \brief Length of a record in a REQUEST_LOG reply, the sequence number is implied
+#define LOG_WIRE_RECORD_LENGTH	(2 + 4 + LOG_MAX_DATA_LEN)
+
+//! \def LOG_RECORDS_PER_MSG
+//! \brief Records that fit in one reply next to the header, CRC, first sequence number and count
+#define LOG_RECORDS_PER_MSG		((MAXMSGLEN - 2 - SP_HEADERSIZE - 3) / LOG_WIRE_RECORD_LENGTH)
+//! @}
+
+//! @name Record Word Offsets
+//! The order the words of a record are laid out in flash.  The sequence
+//! number is written last and marks the record as complete.
+//! @{
+#define LOG_SEQ_WORD			0	//!< Sequence number, 0xFFFF for a free record
+#define LOG_ID_WORD				1	//!< Data generator (low byte) and data length (high byte), 0 for a dead record
+#define LOG_TIME_LO_WORD		2	//!< Time stamp, low word
+#define LOG_TIME_HI_WORD		3	//!< Time stamp, high word
+#define LOG_DATA_WORD			4	//!< First of two data words
+//! @}
+
+// log.c function prototypes
+//! @name log module Functions
+//! These functions append to and read back the measurement log
+//! @{
+void vLog_Init(void);
+uint8 ucLog_Append(uint8 ucDataGen, uint8 ucLength, uint32 ulTimestamp, uint8 *pucData);
+uint8 ucLog_Fetch(uint16 uiFromSeq, uint8 *pucBuff);
+uint8 ucLog_FetchFrame(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast);
+//! @}
+
+#endif /*LOG_H_*/
+//! @}
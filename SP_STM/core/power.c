@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file power.c
+//! \brief This module scales MCLK to the task, picks the sleep mode and
+//! monitors the supply
+//!
+//! @addtogroup core
+//! @{
+//!
+
+#include <msp430F235.h>
+#include "core.h"
+
+//******************  Supply Monitor Variables  *****************************//
+//! @name Supply Monitor Variables
+//! Shared with ADC12_ISR
+//! @{
+//! \var g_uiPWR_SupplySum
+//! \brief The running average << PWR_SUPPLY_AVG_SHIFT, 0 until the first sample
+volatile uint16 g_uiPWR_SupplySum;
+
+//! \var g_ucPWR_SupplyBusy
+//! \brief 1 while a conversion is running
+volatile uint8 g_ucPWR_SupplyBusy;
+
+//! \var g_ucPWR_SupplyWait
+//! \brief 1 while vPWR_WaitSupply() sleeps, ADC12_ISR then wakes the CPU
+volatile uint8 g_ucPWR_SupplyWait;
+//! @}
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Switches MCLK to a clock profile
+//!
+//! SMCLK is left at DCO/4 so nothing timed from it notices the switch.
+//!   \param ucProfile, PWR_PROFILE_FAST or PWR_PROFILE_SLOW
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vPWR_SetProfile(uint8 ucProfile)
+{
+	if (ucProfile == PWR_PROFILE_SLOW)
+		BCSCTL2 = SELM_0 | DIVM_2 | DIVS_2;	// MCLK = DCO/4    SMCLK = DCO / 4
+	else
+		BCSCTL2 = SELM_0 | DIVM_0 | DIVS_2;	// MCLK = DCO/1    SMCLK = DCO / 4
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sleeps until an interrupt ends the low power mode
+//!
+//! ACLK only feeds the scheduler tick (TimerA).  While it is
+//! stopped the SP sleeps in LPM4 and the CP wakes it on SDA or INT_PIN.  The
+//! DCO calibration is loaded again after LPM4.  The VLO is calibrated once
+//! at boot, see vSched_Init().
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vPWR_Sleep(void)
+{
+#if PWR_DEEP_IDLE_ENABLED
+	if (!(TACTL & (MC0 | MC1)))
+	{
+		LPM4;
+
+		// Reload the DCO calibration, keep the ACLK settings
+		DCOCTL = CALDCO_16MHZ;
+		BCSCTL1 = (BCSCTL1 & ~(RSEL3 | RSEL2 | RSEL1 | RSEL0)) | (CALBC1_16MHZ & (RSEL3 | RSEL2 | RSEL1 | RSEL0));
+		return;
+	}
+#endif
+
+	LPM3;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Starts a supply conversion and returns without waiting for it
+//!
+//! ADC12_ISR adds the sample to the running average and turns the ADC and the
+//! reference off again.  The 256 cycle sample time (about 50 us of ADC12OSC)
+//! covers the settling of the reference, so nothing is spent waiting for it.
+//! Does nothing if a conversion is already running.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vPWR_StartSupply(void)
+{
+	if (g_ucPWR_SupplyBusy)
+		return;
+
+	g_ucPWR_SupplyBusy = 1;
+
+	ADC12CTL0 &= ~ENC; // ENC has to be off to change the settings
+	ADC12CTL0 = SHT1_8 | REF2_5V | REFON | ADC12ON; // 256 cycle sample, 2.5V ref on, ADC on
+	ADC12CTL1 = CSTARTADD_15 | SHP; // MEM15, ADC12OSC, single channel single conversion
+	ADC12MCTL15 = SREF_1 | INCH_11; // Vref+ and AVss, (AVcc - AVss) / 2
+	ADC12IFG &= ~ADC12IFG15;
+	ADC12IE |= ADC12IE15;
+
+	ADC12CTL0 |= ENC + ADC12SC; // Sampling and conversion start
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sleeps in LPM0 until the running supply conversion is done
+//!
+//! Only the ADC interrupt ends the wait, events of other interrupts are left
+//! for the caller.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vPWR_WaitSupply(void)
+{
+	__disable_interrupt();
+	g_ucPWR_SupplyWait = 1;
+	while (g_ucPWR_SupplyBusy)
+	{
+		// Enabling the interrupts and sleeping is one instruction, the ISR can not slip in between
+		__bis_SR_register(LPM0_bits + GIE);
+		__disable_interrupt();
+	}
+	g_ucPWR_SupplyWait = 0;
+	__enable_interrupt();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the running average of the supply
+//!   \param none
+//!   \return The supply voltage * 100, 0 if it was never measured
+///////////////////////////////////////////////////////////////////////////////
+uint16 uiPWR_GetSupply(void)
+{
+	return g_uiPWR_SupplySum >> PWR_SUPPLY_AVG_SHIFT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Checks if the supply may brown out while the STMs are excited
+//!   \param none
+//!   \return 1 if the average is below PWR_EXCITE_MIN_VOLTAGE, else 0
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucPWR_SupplyLow(void)
+{
+	if (g_uiPWR_SupplySum == 0)
+		return 0;
+
+	return (uiPWR_GetSupply() < PWR_EXCITE_MIN_VOLTAGE) ? 1 : 0;
+}
+
+//! @}
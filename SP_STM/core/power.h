@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file power.h
+//! \brief Header file for the power module
+//!
+//! Clock profiles, the sleep mode and the supply monitor.
+//!
+//! @addtogroup core
+//! @{
+
+#ifndef POWER_H_
+#define POWER_H_
+
+//! \def PWR_DEEP_IDLE_ENABLED
+//! \brief Sleep in LPM4 instead of LPM3 while nothing needs ACLK
+#define PWR_DEEP_IDLE_ENABLED	1
+
+//! @name Clock Profiles
+//! The DCO stays at 16 MHz and SMCLK at DCO/4 = 4 MHz in every profile: the
+//! STM bit timing, the TBCCR2 deadline, the flash timing generator and the
+//! diagnostics clock are all counted in SMCLK.  Only MCLK is scaled.
+//! @{
+#define PWR_PROFILE_FAST		0	//!< MCLK = 16 MHz, bit banging the CP link
+#define PWR_PROFILE_SLOW		1	//!< MCLK = 4 MHz, sensor reads, parsing and logging
+//! @}
+
+//! @name Supply Monitor
+//! The supply is measured on ADC12MEM15, (AVcc - AVss) / 2 against the 2.5 V
+//! reference, and kept as a running average in units of 10 mV.
+//! @{
+//! \def PWR_SUPPLY_AVG_SHIFT
+//! \brief Every sample moves the average by 1 / 2^PWR_SUPPLY_AVG_SHIFT of the difference
+#define PWR_SUPPLY_AVG_SHIFT	2
+
+//! \def PWR_EXCITE_MIN_VOLTAGE
+//! \brief Below this average the supply may brown out while the STMs are excited
+//! The value is 2.4V, MIN_VOLTAGE plus the sag of an excite cycle
+#define PWR_EXCITE_MIN_VOLTAGE	0xF0
+//! @}
+
+// power.c function prototypes
+//! @name power module Functions
+//! These functions pick the clocks and the sleep mode
+//! @{
+void vPWR_SetProfile(uint8 ucProfile);
+void vPWR_Sleep(void);
+void vPWR_StartSupply(void);
+void vPWR_WaitSupply(void);
+uint16 uiPWR_GetSupply(void);
+uint8 ucPWR_SupplyLow(void);
+//! @}
+
+#endif /*POWER_H_*/
+//! @}
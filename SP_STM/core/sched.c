@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file sched.c
+//! \brief This module runs the software timers and the deferred work
+//!
+//! TimerA ticks once a second from ACLK = VLO/4 whenever a software timer is
+//! running.  TIMERA0_ISR counts the timers down and posts the event of each
+//! one that expires.  ISRs only post events, the handlers run one after the
+//! other from vSched_Run() in the core loop, so they do not have to guard
+//! against each other.  TimerB stays with the STM reads and the diagnostics
+//! clock.
+//!
+//! @addtogroup core
+//! @{
+//!
+
+#include <msp430F235.h>
+#include "core.h"
+
+//******************  Scheduler Variables  **********************************//
+//! @name Scheduler Variables
+//! Shared with TIMERA0_ISR
+//! @{
+//! \var g_saSched_Timer
+//! \brief The software timers
+S_Sched_Timer g_saSched_Timer[SCHED_NUM_TIMERS];
+
+//! \var g_ucSched_Expired
+//! \brief Mask of the timers that expired and were not taken by ucSched_TakeExpired()
+volatile uint8 g_ucSched_Expired;
+
+//! \var g_ucSched_Pending
+//! \brief Mask of the events posted and not yet handled
+volatile uint8 g_ucSched_Pending;
+//! @}
+
+//! \var g_pfnaSched_Handler
+//! \brief The handler of each event, NULL drops the event
+static void (*g_pfnaSched_Handler[SCHED_NUM_EVENTS])(void);
+
+//! \var g_uiSched_TickCCR
+//! \brief The TACCR0 value of a one second tick, from uiSched_CalibrateTick()
+static uint16 g_uiSched_TickCCR;
+
+//******************  Functions  ********************************************//
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Works out one second of ACLK
+//!
+//! The VLO frequency should be 12 kHz, but it can range from 4 kHZ to 20 kHz.
+//! TimerA counts 8.333 ms of SMCLK while TimerB counts the VLO, which gives
+//! 100 ticks at 12 kHz.  The deviation from 100 is scaled up to a full second.
+//! TimerB is borrowed, so this only runs from vSched_Init() at boot, before
+//! vDiag_Init() starts the diagnostics clock and before any STM read.
+//!   \param none
+//!   \return The TACCR0 value of a one second tick at ACLK = VLO/4
+///////////////////////////////////////////////////////////////////////////////
+static uint16 uiSched_CalibrateTick(void)
+{
+	int16 iVLOCal;
+
+	// Set ACLK divider to 1
+	BCSCTL1 &= ~DIVA_3;
+
+	TACTL = (TASSEL_2 | TACLR | ID_2);
+	TACCR0 = 8333;
+	TBCTL = (TBSSEL_1 | TBCLR);
+	TACTL |= MC_1;
+	TBCTL |= MC_2;
+	while ((TACCTL0 & CCIFG) == 0);
+
+	iVLOCal = (int16) (TBR - 100) * 120;
+
+	TACTL = TACLR;
+	TBCTL = TBCLR;
+	TACCR0 = 0;
+
+	// Set ACLK divider back to 4
+	BCSCTL1 |= DIVA_2;
+
+	return (uint16) ((SCHED_VLO_NOMINAL_HZ + iVLOCal) >> 2) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Clears the timers, the events and the handlers
+//!
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSched_Init(void)
+{
+	uint8 ucIdx;
+
+	TACTL = TACLR;
+
+	for (ucIdx = 0; ucIdx < SCHED_NUM_TIMERS; ucIdx++)
+		g_saSched_Timer[ucIdx].m_uiPeriod = 0;
+
+	for (ucIdx = 0; ucIdx < SCHED_NUM_EVENTS; ucIdx++)
+		g_pfnaSched_Handler[ucIdx] = NULL;
+
+	g_ucSched_Expired = 0;
+	g_ucSched_Pending = 0;
+
+	g_uiSched_TickCCR = uiSched_CalibrateTick();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sets the handler of an event
+//!
+//!   \param ucEvent, 0 to SCHED_NUM_EVENTS - 1
+//!   \param pfnHandler, runs from vSched_Run() once per posting, NULL drops the event
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSched_SetHandler(uint8 ucEvent, void (*pfnHandler)(void))
+{
+	if (ucEvent < SCHED_NUM_EVENTS)
+		g_pfnaSched_Handler[ucEvent] = pfnHandler;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Starts, restarts or stops a software timer
+//!
+//! The tick only runs while a timer does, otherwise the SP can sleep in
+//! LPM4, see vPWR_Sleep().  Its period comes from the VLO calibration at
+//! boot, so starting it does not disturb a phase timed by the diagnostics
+//! clock.
+//!   \param ucTimer, 0 to SCHED_NUM_TIMERS - 1
+//!   \param uiPeriod, the seconds between expiries, 0 stops the timer
+//!   \param ucEvent, the event to post on every expiry
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSched_StartTimer(uint8 ucTimer, uint16 uiPeriod, uint8 ucEvent)
+{
+	uint8 ucIdx;
+	uint8 ucRunning;
+
+	if (ucTimer >= SCHED_NUM_TIMERS)
+		return;
+
+	// Change the timer with the tick held off
+	TACCTL0 &= ~CCIE;
+	g_saSched_Timer[ucTimer].m_uiPeriod = uiPeriod;
+	g_saSched_Timer[ucTimer].m_uiCountdown = uiPeriod;
+	g_saSched_Timer[ucTimer].m_ucEvent = ucEvent;
+	g_ucSched_Expired &= ~(1 << ucTimer);
+
+	ucRunning = 0;
+	for (ucIdx = 0; ucIdx < SCHED_NUM_TIMERS; ucIdx++) {
+		if (g_saSched_Timer[ucIdx].m_uiPeriod)
+			ucRunning = 1;
+	}
+
+	if (!ucRunning) {
+		TACTL = TACLR;
+		return;
+	}
+
+	// A running tick keeps its phase
+	if (!(TACTL & (MC0 | MC1))) {
+		TACCR0 = g_uiSched_TickCCR;
+		TACTL = (TASSEL_1 | TACLR);
+		TACTL |= MC_1;
+	}
+	TACCTL0 = CCIE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Takes the timers that expired since the last call
+//!
+//! Lets a handler serve every timer that posted its event at once.
+//!   \param ucTimerMask, the timers to look at, bit n = timer n
+//!   \return The expired timers in the mask
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucSched_TakeExpired(uint8 ucTimerMask)
+{
+	__disable_interrupt();
+	ucTimerMask &= g_ucSched_Expired;
+	g_ucSched_Expired &= ~ucTimerMask;
+	__enable_interrupt();
+
+	return ucTimerMask;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Posts an event from the foreground
+//!
+//! ISRs use SCHED_POST_FROM_ISR() instead, which also wakes the core.
+//!   \param ucEvent, 0 to SCHED_NUM_EVENTS - 1
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSched_Post(uint8 ucEvent)
+{
+	__disable_interrupt();
+	g_ucSched_Pending |= (1 << ucEvent);
+	__enable_interrupt();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Runs the handlers of the posted events
+//!
+//! Each handler runs to completion.  Events posted meanwhile are handled
+//! before returning, so nothing waits for the next wake up.
+//!   \param none
+//!   \return none
+///////////////////////////////////////////////////////////////////////////////
+void vSched_Run(void)
+{
+	uint8 ucPending;
+	uint8 ucEvent;
+
+	while (1) {
+		__disable_interrupt();
+		ucPending = g_ucSched_Pending;
+		g_ucSched_Pending = 0;
+		__enable_interrupt();
+
+		if (!ucPending)
+			return;
+
+		for (ucEvent = 0; ucEvent < SCHED_NUM_EVENTS; ucEvent++) {
+			if ((ucPending & (1 << ucEvent)) && g_pfnaSched_Handler[ucEvent])
+				g_pfnaSched_Handler[ucEvent]();
+		}
+	}
+}
+
+//! @}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file sched.h
+//! \brief Header file for the scheduler module
+//!
+//! Software timers on the TimerA tick and run to completion handlers for the
+//! work the ISRs hand to the foreground.
+//!
+//! @addtogroup core
+//! @{
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+//! @name Scheduler Sizes
+//! Timer and event numbers are bit positions, so both must stay at 8 or below
+//! @{
+#define SCHED_NUM_TIMERS		5	//!< Software timers on the TimerA tick
+#define SCHED_NUM_EVENTS		4	//!< Events with a handler
+//! @}
+
+//! @name Core Timer
+//! The last timer and event belong to the core, which counts down its waits
+//! for the CP with them.  The event has no handler, it only wakes the core.
+//! @{
+#define SCHED_CORE_TIMER		(SCHED_NUM_TIMERS - 1)
+#define SCHED_CORE_EVT			(SCHED_NUM_EVENTS - 1)
+//! @}
+
+//! \def SCHED_VLO_NOMINAL_HZ
+//! \brief The typical VLO frequency the tick is calibrated against
+#define SCHED_VLO_NOMINAL_HZ	12000
+
+//! \struct S_Sched_Timer
+//! \brief A periodic software timer counted down by TIMERA0_ISR
+typedef struct
+{
+	uint16 m_uiPeriod;			//!< Ticks between expiries, 0 = stopped
+	uint16 m_uiCountdown;		//!< Ticks until the next expiry
+	uint8 m_ucEvent;			//!< The event posted when it expires
+} S_Sched_Timer;
+
+//! \var g_ucSched_Pending
+//! \brief Mask of the events posted and not yet handled, defined in sched.c
+extern volatile uint8 g_ucSched_Pending;
+
+//! \def SCHED_POST_FROM_ISR
+//! \brief Posts an event from an ISR and wakes the core to handle it
+#define SCHED_POST_FROM_ISR(event)	{ g_ucSched_Pending |= (1 << (event)); __bic_SR_register_on_exit(LPM4_bits); }
+
+// sched.c function prototypes
+//! @name scheduler module Functions
+//! These functions set up the timers and run the posted events
+//! @{
+void vSched_Init(void);
+void vSched_SetHandler(uint8 ucEvent, void (*pfnHandler)(void));
+void vSched_StartTimer(uint8 ucTimer, uint16 uiPeriod, uint8 ucEvent);
+uint8 ucSched_TakeExpired(uint8 ucTimerMask);
+void vSched_Post(uint8 ucEvent);
+void vSched_Run(void);
+//! @}
+
+#endif /*SCHED_H_*/
+//! @}
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file host.h
+//! \brief Header file for the \ref host Build
+//!
+//! @addtogroup host Host Build
+//! The host build runs the parser, the CRC, the command handling of core.c
+//! and the report formats of main.c on a PC against recorded sensor frames
+//! and CP traces, see host_test.c.
+//! Build it with SP_HOST_BUILD so the core typedefs keep the MSP430 widths.
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HOST_H_
+  #define HOST_H_
+
+  //! \def HOST_FRAME_MAX
+  //! \brief Longest frame that can be queued, room for one that overruns RX_BUFFER_SIZE_STM
+  #define HOST_FRAME_MAX		(RX_BUFFER_SIZE_STM + 12)
+
+  //! \def HOST_LINE_MAX
+  //! \brief Longest line of a fixture file
+  #define HOST_LINE_MAX			256
+
+  void vHost_QueueFrame(uint8 ucChannel, const uint8 *pucFrame, uint8 ucLength);
+  void vHost_SetSupply(uint16 uiSupply);
+  uint8 ucHost_TakeSent(uint8 *pucBuff);
+
+#endif /*HOST_H_*/
+//! @}
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file host_bench.c
+//! \brief Times the hot functions of the host build
+//!
+//! Each function is run a number of times back to back and the average
+//! time per call is printed.  The host is not the MSP430, the numbers are
+//! for comparing two builds of the same code on the same PC, not cycles on
+//! the board.  make bench prints the object sizes after them.
+//!
+//!   host_bench [iterations]
+//!
+//! @addtogroup host Host Build
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#include <msp430x23x.h>
+#include "core.h"
+#include "crc.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//! \def HOST_BENCH_ITERATIONS
+//! \brief Calls per function if none are given
+#define HOST_BENCH_ITERATIONS	100000UL
+
+//! \var g_pcaHost_BenchFrame
+//! \brief What the STMs send, a 5TM on STM1, a 5TE on STM2 and an MPS-6 on STM3
+static const char *g_pcaHost_BenchFrame[3] =
+{
+	"1650 0 612\rx:\n",
+	"1100 120 652\rzY\n",
+	"-21.3 22.4\rl0\n"
+};
+
+//! \var g_ucaHost_BenchCommand
+//! \brief COMMAND_PKT for transducers 1 to 3, so the three STMs are batched
+static uint8 g_ucaHost_BenchCommand[] = { COMMAND_PKT, 10, SP_PACKEDDATA_VERSION, 0, 1, 0, 2, 0, 3, 0 };
+
+//! \var g_ucHost_BenchSink
+//! \brief Takes a result of every call so none is optimized away
+static volatile uint8 g_ucHost_BenchSink;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns a monotonic time stamp
+//!
+//! \return the time in ns
+///////////////////////////////////////////////////////////////////////////////
+static double dHost_Now(void)
+{
+	struct timespec sNow;
+
+	clock_gettime(CLOCK_MONOTONIC, &sNow);
+	return (double) sNow.tv_sec * 1e9 + (double) sNow.tv_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Prints the time per call of a run
+//!
+//! \param pcName, the function that was timed
+//! \param dStart, the time stamp before the run
+//! \param ulIterations, the number of calls
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_Report(const char *pcName, double dStart, unsigned long ulIterations)
+{
+	printf("%-24s %10.1f ns/call\n", pcName, (dHost_Now() - dStart) / (double) ulIterations);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Queues the frames of g_pcaHost_BenchFrame
+//!
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_QueueBenchFrames(void)
+{
+	uint8 ucIdx;
+
+	for (ucIdx = 0; ucIdx < 3; ucIdx++)
+		vHost_QueueFrame(ucIdx + 1, (const uint8 *) g_pcaHost_BenchFrame[ucIdx], strlen(g_pcaHost_BenchFrame[ucIdx]));
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long ulIterations;
+	unsigned long ulIdx;
+	uint8 ucaMsg[MAXMSGLEN + CRC_SZ];
+	const char *pcFrame;
+	double dStart;
+
+	ulIterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : HOST_BENCH_ITERATIONS;
+	if (ulIterations == 0)
+		ulIterations = HOST_BENCH_ITERATIONS;
+
+	printf("%lu calls each\n", ulIterations);
+
+	// One 5TE frame, byte by byte as the receive ISR hands it over
+	pcFrame = g_pcaHost_BenchFrame[1];
+	dStart = dHost_Now();
+	for (ulIdx = 0; ulIdx < ulIterations; ulIdx++)
+	{
+		const char *pcByte;
+
+		vSTM_ParseReset(0);
+		for (pcByte = pcFrame; *pcByte; pcByte++)
+		{
+			if (ucSTM_ParseByte(0, (uint8) *pcByte))
+				break;
+		}
+		g_ucHost_BenchSink = g_saSTM_Parser[0].m_cResult;
+	}
+	vHost_Report("ucSTM_ParseByte (frame)", dStart, ulIterations);
+
+	// The CRC of the longest message, its CRC included
+	memset(ucaMsg, 0xA5, sizeof(ucaMsg));
+	ucaMsg[MSG_LEN_IDX] = MAXMSGLEN - CRC_SZ;
+	dStart = dHost_Now();
+	for (ulIdx = 0; ulIdx < ulIterations; ulIdx++)
+		g_ucHost_BenchSink = ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_SEND, ucaMsg, MAXMSGLEN);
+	vHost_Report("ucCRC16_compute_msg_CRC", dStart, ulIterations);
+
+	// A command, the frames are queued again for every call
+	dStart = dHost_Now();
+	for (ulIdx = 0; ulIdx < ulIterations; ulIdx++)
+	{
+		vHost_QueueBenchFrames();
+		g_ucHost_BenchSink = (uint8) uiCORE_RunCommand(g_ucaHost_BenchCommand);
+	}
+	vHost_Report("uiCORE_RunCommand", dStart, ulIterations);
+
+	// The reports of what the last command measured
+	dStart = dHost_Now();
+	for (ulIdx = 0; ulIdx < ulIterations; ulIdx++)
+		g_ucHost_BenchSink = ucMain_FetchData(&ucaMsg[MSG_PAYLD_IDX]);
+	vHost_Report("ucMain_FetchData", dStart, ulIterations);
+
+	dStart = dHost_Now();
+	for (ulIdx = 0; ulIdx < ulIterations; ulIdx++)
+		g_ucHost_BenchSink = ucMain_FetchPackedData(&ucaMsg[MSG_PAYLD_IDX], SP_PACKEDVWC_VERSION);
+	vHost_Report("ucMain_FetchPackedData", dStart, ulIterations);
+
+	return 0;
+}
+
+//! @}
@@ -0,0 +1,23 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file host_regs.c
+//! \brief The registers of the host build, see include/msp430x23x.h
+//!
+//! @addtogroup host Host Build
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#include <msp430x23x.h>
+
+volatile unsigned char P1IN, P1OUT, P1DIR, P1IFG, P1IES, P1IE, P1SEL, P1REN;
+volatile unsigned char P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL, P2REN;
+volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL, P3REN;
+volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL, P4REN;
+volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL, P5REN;
+volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL, P6REN;
+volatile unsigned char DCOCTL, BCSCTL1, BCSCTL2, BCSCTL3;
+const volatile unsigned char CALDCO_16MHZ, CALBC1_16MHZ;
+volatile unsigned int WDTCTL;
+volatile unsigned int TACTL, TAR, TACCTL0, TACCR0;
+volatile unsigned int TBCTL, TBR, TBCCTL0, TBCCR0;
+
+//! @}
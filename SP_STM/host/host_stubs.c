@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file host_stubs.c
+//! \brief The modules the host build leaves out
+//!
+//! main.c, core.c, STM_parse.c and crc.c are built as they are for the board.
+//! What they call in the other core modules and in the STM driver is replaced
+//! here.  A message sent to the CP is kept for ucHost_TakeSent().  An STM
+//! measurement replays the frame queued with vHost_QueueFrame() through
+//! ucSTM_ParseByte(), the same as TIMERB1_ISR does with the bytes off the
+//! line, so the readings reach S_Report the way they do on the board.
+//!
+//! @addtogroup host Host Build
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#include <msp430x23x.h>
+#include "core.h"
+#include "host.h"
+
+//! \var g_ucaHost_Frame
+//! \brief The frame each STM channel sends when it is next excited
+static uint8 g_ucaHost_Frame[NUM_STM_CHANNELS][HOST_FRAME_MAX];
+
+//! \var g_ucaHost_FrameLen
+//! \brief Bytes in g_ucaHost_Frame, 0 if the sensor stays silent
+static uint8 g_ucaHost_FrameLen[NUM_STM_CHANNELS];
+
+//! \var g_ucaHost_Burst
+//! \brief Frames per measurement as set by ucSTM_SetBurst()
+static uint8 g_ucaHost_Burst[NUM_STM_CHANNELS] = { 1, 1, 1, 1 };
+
+//! \var g_ucHost_LastChannelIdx
+//! \brief The channel of the last cSTM_Measure(), its parser holds the readings
+static uint8 g_ucHost_LastChannelIdx;
+
+//! \var g_uiHost_Supply
+//! \brief What uiPWR_GetSupply() returns, 0 before the first reading
+static uint16 g_uiHost_Supply;
+
+//! \var g_ucaHost_Sent
+//! \brief The last message vCOMM_SendMessage() was given
+static uint8 g_ucaHost_Sent[MAXMSGLEN];
+
+//! \var g_ucHost_SentLen
+//! \brief Bytes in g_ucaHost_Sent, 0 once it has been taken
+static uint8 g_ucHost_SentLen;
+
+volatile uint8 g_ucaRXBuffer[MAXMSGLEN];
+uint8 g_ucaCOMM_Reply[MAXMSGLEN];
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Queues the frame an STM channel sends on its next measurement
+//!
+//! \param ucChannel, 1 = STM1
+//! \param pucFrame, the bytes as sent by the sensor
+//! \param ucLength, 0 for a sensor that does not answer
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+void vHost_QueueFrame(uint8 ucChannel, const uint8 *pucFrame, uint8 ucLength)
+{
+	uint8 ucIdx;
+
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS) || (ucLength > HOST_FRAME_MAX))
+		return;
+
+	for (ucIdx = 0; ucIdx < ucLength; ucIdx++)
+		g_ucaHost_Frame[ucChannel - 1][ucIdx] = pucFrame[ucIdx];
+	g_ucaHost_FrameLen[ucChannel - 1] = ucLength;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Sets what the supply monitor reports
+//!
+//! \param uiSupply, the supply in mV, 0 for no reading yet
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+void vHost_SetSupply(uint16 uiSupply)
+{
+	g_uiHost_Supply = uiSupply;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Takes the last message the SP sent to the CP
+//!
+//! \param pucBuff, room for MAXMSGLEN bytes
+//! \return the length of the message, 0 if nothing was sent since the last call
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucHost_TakeSent(uint8 *pucBuff)
+{
+	uint8 ucLength;
+	uint8 ucIdx;
+
+	ucLength = g_ucHost_SentLen;
+	for (ucIdx = 0; ucIdx < ucLength; ucIdx++)
+		pucBuff[ucIdx] = g_ucaHost_Sent[ucIdx];
+	g_ucHost_SentLen = 0;
+
+	return ucLength;
+}
+
+void vCOMM_SendMessage(volatile uint8 * pBuff, uint8 ucLength)
+{
+	uint8 ucIdx;
+
+	if (ucLength > MAXMSGLEN)
+		ucLength = MAXMSGLEN;
+
+	for (ucIdx = 0; ucIdx < ucLength; ucIdx++)
+		g_ucaHost_Sent[ucIdx] = pBuff[ucIdx];
+	g_ucHost_SentLen = ucLength;
+}
+
+// The CP side is replayed by host_test.c, vCORE_Run() is not
+void vCOMM_Init(void) {}
+void vCOMM_RaiseInt(void) {}
+void vCOMM_ReleaseInt(void) {}
+uint8 ucCOMM_WaitForMessage(void) { return 0; }
+uint8 ucCOMM_WaitForStartCondition(void) { return 0; }
+uint8 ucCOMM_CheckMessage(void) { return COMM_OK; }
+uint8 ucCOMM_SendSegmented(uint8 ucType, uint8 ucFlags, uint8 (*pfnFill)(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast), uint16 uiCursor) { return 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Replays the queued frame of a channel through the parser
+//!
+//! One frame stands for the whole burst.
+//!
+//! \param ucChannel, 1 = STM1
+//! \return 0, STM_ERROR_CODE_1 or STM_ERROR_CODE_2 as on the board
+///////////////////////////////////////////////////////////////////////////////
+char cSTM_Measure(uint8 ucChannel)
+{
+	uint8 ucChannelIdx;
+	uint8 ucIdx;
+
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return STM_ERROR_CODE_3;
+
+	ucChannelIdx = ucChannel - 1;
+	g_ucHost_LastChannelIdx = ucChannelIdx;
+
+	vSTM_ParseReset(ucChannelIdx);
+	for (ucIdx = 0; ucIdx < g_ucaHost_FrameLen[ucChannelIdx]; ucIdx++)
+	{
+		if (ucSTM_ParseByte(ucChannelIdx, g_ucaHost_Frame[ucChannelIdx][ucIdx]))
+			break;
+	}
+
+	// The sensor answers once
+	g_ucaHost_FrameLen[ucChannelIdx] = 0;
+
+	return g_saSTM_Parser[ucChannelIdx].m_cResult;
+}
+
+signed long lSTM_GetSoil(void)
+{
+	return g_saSTM_Parser[g_ucHost_LastChannelIdx].m_lSoil;
+}
+
+signed int iSTM_GetTemp(void)
+{
+	return g_saSTM_Parser[g_ucHost_LastChannelIdx].m_nTemperature;
+}
+
+uint8 ucSTM_SetBurst(uint8 ucChannel, uint8 ucFrames)
+{
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS) || (ucFrames == 0) || (ucFrames > STM_BURST_MAX))
+		return 1;
+
+	g_ucaHost_Burst[ucChannel - 1] = ucFrames;
+	return 0;
+}
+
+uint8 ucSTM_GetBurst(uint8 ucChannel)
+{
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return 1;
+
+	return g_ucaHost_Burst[ucChannel - 1];
+}
+
+// A replayed burst is one frame, so its frames never spread
+uint16 uiSTM_GetSpread(void)
+{
+	return 0;
+}
+
+// Each channel replays its frame when uiMain_STM() picks it up
+void vSTM_MeasureBatch(uint8 ucChannelMask) {}
+
+uint8 cSTM_ReturnSensorType(uint8 ucChannel)
+{
+	if ((ucChannel == 0) || (ucChannel > NUM_STM_CHANNELS))
+		return STM_TYPE_UNKNOWN;
+
+	return g_saSTM_Parser[ucChannel - 1].m_ucSensorType;
+}
+
+uint8 cSTM_RequestSensorType(uint8 ucChannel)
+{
+	return cSTM_Measure(ucChannel);
+}
+
+void vSTM_Initialize(void) {}
+void vSTM_LoadSensorTypes(void) {}
+uint8 ucSTM_GetTypeGen(void) { return 0; }
+uint8 ucSTM_FetchHealth(uint8 *pucBuff) { return 0; }
+uint16 uiSTM_GetDurationMs(uint8 ucChannel) { return 0; }
+
+uint16 uiPWR_GetSupply(void)
+{
+	return g_uiHost_Supply;
+}
+
+// MCLK and the supply monitor are the board's
+void vPWR_SetProfile(uint8 ucProfile) {}
+void vPWR_StartSupply(void) {}
+void vPWR_WaitSupply(void) {}
+
+// Nothing is stored, the restore functions keep their defaults
+void vConfig_Init(void) {}
+uint8 ucConfig_Read(uint8 ucKey, uint16 *puiData, uint8 ucCount) { return 0; }
+uint8 ucConfig_Write(uint8 ucKey, uint16 *puiData, uint8 ucCount) { return 0; }
+void vLog_Init(void) {}
+uint8 ucLog_Append(uint8 ucDataGen, uint8 ucLength, uint32 ulTimestamp, uint8 *pucData) { return 0; }
+uint8 ucLog_Fetch(uint16 uiFromSeq, uint8 *pucBuff) { return 0; }
+uint8 ucLog_FetchFrame(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast) { return 0; }
+void vFlash_GetBSLPW(uint8 *p_ucBuff) {}
+
+void vSched_Init(void) {}
+void vSched_Run(void) {}
+void vSched_SetHandler(uint8 ucEvent, void (*pfnHandler)(void)) {}
+void vSched_StartTimer(uint8 ucTimer, uint16 uiPeriod, uint8 ucEvent) {}
+uint8 ucSched_TakeExpired(uint8 ucTimerMask) { return 0; }
+
+// TimerB is the board's, nothing is timed
+void vDiag_Init(void) {}
+void vDiag_Clear(void) {}
+void vDiag_Begin(uint8 ucPhase) {}
+void vDiag_End(uint8 ucPhase) {}
+void vDiag_PaintStack(void) {}
+uint8 ucDiag_Fetch(uint8 ucPhase, uint8 *pucBuff) { return 0; }
+
+//! @}
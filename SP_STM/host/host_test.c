@@ -0,0 +1,422 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file host_test.c
+//! \brief Replays the recorded fixtures against the host build
+//!
+//! fixtures/stm_frames.txt holds sensor frames with the readings they decode
+//! to, they are fed byte by byte through ucSTM_ParseByte().
+//! fixtures/cp_traces.txt holds CP sessions.  The messages from the CP are
+//! handled by the functions of vCORE_Run() and every reply of the SP is
+//! compared byte for byte, CRC included, with the recorded one.  The formats
+//! are described in the files.
+//!
+//!   host_test [fixture directory]
+//!
+//! 1 is returned if a check failed.
+//!
+//! @addtogroup host Host Build
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#include <msp430x23x.h>
+#include "core.h"
+#include "crc.h"
+#include "host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! \def HOST_CHECK
+//! \brief Counts and prints a failed check
+#define HOST_CHECK(cond, ...)											\
+	do {																\
+		g_uiHost_Checks++;												\
+		if (!(cond)) {													\
+			g_uiHost_Failures++;										\
+			printf("%s:%u: ", g_pcHost_File, g_uiHost_Line);			\
+			printf(__VA_ARGS__);										\
+			printf("\n");												\
+		}																\
+	} while (0)
+
+//! \var g_uiHost_Checks
+//! \brief Checks made
+static unsigned int g_uiHost_Checks;
+
+//! \var g_uiHost_Failures
+//! \brief Checks failed
+static unsigned int g_uiHost_Failures;
+
+//! \var g_pcHost_File
+//! \brief The fixture being replayed, for the messages
+static const char *g_pcHost_File = "host_test.c";
+
+//! \var g_uiHost_Line
+//! \brief The line of the fixture being replayed
+static unsigned int g_uiHost_Line;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Reads hex bytes separated by white space
+//!
+//! \param pcText, the text
+//! \param pucBuff, destination
+//! \param uiMax, size of pucBuff
+//! \return The number of bytes, -1 if the text is not hex or does not fit
+///////////////////////////////////////////////////////////////////////////////
+static int iHost_ParseHex(const char *pcText, uint8 *pucBuff, unsigned int uiMax)
+{
+	unsigned int uiCount;
+	unsigned long ulByte;
+	char *pcEnd;
+
+	uiCount = 0;
+	while (TRUE)
+	{
+		while ((*pcText == ' ') || (*pcText == '\t'))
+			pcText++;
+		if ((*pcText == 0) || (*pcText == '\r') || (*pcText == '\n'))
+			return uiCount;
+
+		ulByte = strtoul(pcText, &pcEnd, 16);
+		if ((pcEnd == pcText) || (ulByte > 0xFF) || (uiCount >= uiMax))
+			return -1;
+
+		pucBuff[uiCount++] = (uint8) ulByte;
+		pcText = pcEnd;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the next line of a fixture that is not blank or a comment
+//!
+//! \param pFile, the fixture
+//! \param pcLine, destination of HOST_LINE_MAX bytes
+//! \return 1 if a line was read, 0 at the end of the file
+///////////////////////////////////////////////////////////////////////////////
+static uint8 ucHost_NextLine(FILE *pFile, char *pcLine)
+{
+	while (fgets(pcLine, HOST_LINE_MAX, pFile))
+	{
+		g_uiHost_Line++;
+		if ((pcLine[0] != '#') && (pcLine[0] != '\r') && (pcLine[0] != '\n') && (pcLine[0] != 0))
+			return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Opens a fixture
+//!
+//! \param pcDir, the fixture directory
+//! \param pcName, the file
+//! \return The file, NULL (counted as a failure) if it can not be opened
+///////////////////////////////////////////////////////////////////////////////
+static FILE *pHost_Open(const char *pcDir, const char *pcName)
+{
+	static char cPath[HOST_LINE_MAX];
+	FILE *pFile;
+
+	snprintf(cPath, sizeof(cPath), "%s/%s", pcDir, pcName);
+	g_pcHost_File = cPath;
+	g_uiHost_Line = 0;
+
+	pFile = fopen(cPath, "r");
+	HOST_CHECK(pFile != NULL, "can not open the fixture");
+
+	return pFile;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Checks the CRC against the test vector and a round trip of a message
+//!
+//! \param none
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_TestCRC(void)
+{
+	static const char cVector[] = "123456789";
+	uint8 ucaCRC[2];
+	uint8 ucaMacroCRC[2];
+	uint8 ucaMsg[SP_HEADERSIZE + 2 + CRC_SZ] = { REPORT_DATA, SP_HEADERSIZE + 2, SP_DATAMESSAGE_VERSION, 0, 0xBE, 0xEF };
+	uint8 ucIdx;
+
+	g_pcHost_File = "host_test.c";
+	g_uiHost_Line = __LINE__;
+
+	// The table per byte and the function around it
+	CRC16_INIT(ucaCRC);
+	CRC16_INIT(ucaMacroCRC);
+	for (ucIdx = 0; cVector[ucIdx]; ucIdx++)
+	{
+		vCRC16_updateByte(cVector[ucIdx], ucaCRC);
+		CRC16_UPDATE_BYTE(cVector[ucIdx], ucaMacroCRC);
+	}
+	HOST_CHECK((ucaCRC[CRC16_HI] == 0x29) && (ucaCRC[CRC16_LO] == 0xB1),
+			"vCRC16_updateByte() gives %02X%02X for the test vector", ucaCRC[CRC16_HI], ucaCRC[CRC16_LO]);
+	HOST_CHECK((ucaMacroCRC[CRC16_HI] == 0x29) && (ucaMacroCRC[CRC16_LO] == 0xB1),
+			"CRC16_UPDATE_BYTE() gives %02X%02X for the test vector", ucaMacroCRC[CRC16_HI], ucaMacroCRC[CRC16_LO]);
+
+	// The CRC of a message is stuffed behind it and checks as zero on the other side
+	HOST_CHECK(ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_SEND, ucaMsg, sizeof(ucaMsg)) == 1, "the CRC of a message can not be sent");
+	HOST_CHECK(ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_REC, ucaMsg, sizeof(ucaMsg)) == 1, "a message does not take its own CRC");
+
+	ucaMsg[MSG_PAYLD_IDX] ^= 0x01;
+	HOST_CHECK(ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_REC, ucaMsg, sizeof(ucaMsg)) == 0, "a flipped bit passes the CRC");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Checks the retries cSTM_Measure() may start within the budget
+//!
+//! \param none
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_TestRetryBudget(void)
+{
+	uint16 uiReadMs;
+	uint16 uiSpentMs;
+	uint16 uiRestMs;
+
+	g_pcHost_File = "host_test.c";
+	g_uiHost_Line = __LINE__;
+
+	// An unknown type or a missed window reads the full timeout, one retry still fits
+	uiReadMs = STM_POWER_UP_MS + uiSTM_GetTimeoutMs(STM_TYPE_UNKNOWN);
+	uiSpentMs = uiReadMs;
+	uiRestMs = uiSTM_GetRetryRestMs(uiSpentMs, 0, uiReadMs);
+	HOST_CHECK(uiRestMs == 2 * STM_BURST_REST_MS, "the first retry after %u ms rests %u ms", uiSpentMs, uiRestMs);
+
+	// The second would run past the budget
+	uiSpentMs += uiRestMs + uiReadMs;
+	uiRestMs = uiSTM_GetRetryRestMs(uiSpentMs, 1, uiReadMs);
+	HOST_CHECK(uiRestMs == 0, "a second full retry after %u ms rests %u ms", uiSpentMs, uiRestMs);
+
+	// A burst of two full reads has used the budget up
+	uiSpentMs = uiReadMs + STM_BURST_REST_MS + uiReadMs;
+	uiRestMs = uiSTM_GetRetryRestMs(uiSpentMs, 0, uiReadMs);
+	HOST_CHECK(uiRestMs == 0, "a retry after a burst of %u ms rests %u ms", uiSpentMs, uiRestMs);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Replays fixtures/stm_frames.txt through ucSTM_ParseByte()
+//!
+//! A frame must finish on its last byte, one cut short must not finish.
+//!
+//! \param pcDir, the fixture directory
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_TestFrames(const char *pcDir)
+{
+	FILE *pFile;
+	char cLine[HOST_LINE_MAX];
+	char caField[5][16];
+	uint8 ucaFrame[HOST_FRAME_MAX];
+	S_STM_Parser *pParser;
+	int iResult;
+	int iLength;
+	int iOffset;
+	int iIdx;
+	uint8 ucDone;
+
+	pFile = pHost_Open(pcDir, "stm_frames.txt");
+	if (pFile == NULL)
+		return;
+
+	pParser = &g_saSTM_Parser[0];
+	while (ucHost_NextLine(pFile, cLine))
+	{
+		if (sscanf(cLine, "%15s %15s %15s %15s %15s %n", caField[0], caField[1], caField[2], caField[3], caField[4], &iOffset) != 5)
+		{
+			HOST_CHECK(0, "not a frame line");
+			continue;
+		}
+		iLength = iHost_ParseHex(&cLine[iOffset], ucaFrame, sizeof(ucaFrame));
+		HOST_CHECK(iLength > 0, "the frame bytes do not read");
+		if (iLength <= 0)
+			continue;
+
+		vSTM_ParseReset(0);
+		ucDone = 0;
+		for (iIdx = 0; iIdx < iLength; iIdx++)
+		{
+			ucDone = ucSTM_ParseByte(0, ucaFrame[iIdx]);
+			if (ucDone)
+				break;
+		}
+
+		iResult = atoi(caField[0]);
+		HOST_CHECK(pParser->m_cResult == iResult, "result %d, expected %d", pParser->m_cResult, iResult);
+		if (iResult == STM_ERROR_CODE_2)
+			HOST_CHECK(!ucDone, "a frame cut short is finished");
+		else
+			HOST_CHECK(ucDone && (iIdx == iLength - 1), "the frame finished at byte %d of %d", iIdx + 1, iLength);
+
+		if (iResult != 0)
+			continue;
+
+		HOST_CHECK(pParser->m_lSoil == atol(caField[1]), "soil %ld, expected %s", (long) pParser->m_lSoil, caField[1]);
+		HOST_CHECK(pParser->m_nTemperature == atoi(caField[2]), "temperature %d, expected %s", pParser->m_nTemperature, caField[2]);
+		if (caField[3][0] != '-')
+			HOST_CHECK(iSTM_DDITempToTenths(pParser->m_nTemperature) == atoi(caField[3]),
+					"degrees C x10 %d, expected %s", iSTM_DDITempToTenths(pParser->m_nTemperature), caField[3]);
+		if (caField[4][0] != '-')
+			HOST_CHECK(uiSTM_SoilToVWC(pParser->m_lSoil) == atoi(caField[4]),
+					"VWC %u, expected %s", uiSTM_SoilToVWC(pParser->m_lSoil), caField[4]);
+	}
+
+	fclose(pFile);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Handles a message from the CP the way vCORE_Run() does
+//!
+//! Only the messages of the report path are replayed, COMMAND_PKT without
+//! CMD_REPORT_BIT and REQUEST_DATA.  The work is done by the functions
+//! vCORE_Run() calls for them.
+//!
+//! \param pucRequest, the message
+//! \param pucReply, the reply, its length byte is 0 if nothing is sent
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_HandleMessage(uint8 *pucRequest, uint8 *pucReply)
+{
+	static uint16 unTransducerReturn;
+
+	pucReply[MSG_LEN_IDX] = 0;
+
+	switch (pucRequest[MSG_TYP_IDX])
+	{
+		case COMMAND_PKT:
+			vCORE_Send_ConfirmPKT();
+			ucHost_TakeSent(pucReply);
+
+			unTransducerReturn = uiCORE_RunCommand(pucRequest);
+		break;
+
+		case REQUEST_DATA:
+			pucReply[MSG_FLAGS_IDX] = pucRequest[MSG_FLAGS_IDX];
+			vCORE_BuildReport(pucReply, pucRequest[MSG_VER_IDX], unTransducerReturn);
+		break;
+
+		default:
+			HOST_CHECK(0, "message type %02X is not replayed", pucRequest[MSG_TYP_IDX]);
+		break;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Replays fixtures/cp_traces.txt
+//!
+//! \param pcDir, the fixture directory
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vHost_TestTrace(const char *pcDir)
+{
+	FILE *pFile;
+	char cLine[HOST_LINE_MAX];
+	char cKind[8];
+	uint8 ucaRequest[MAXMSGLEN + CRC_SZ];
+	uint8 ucaReply[MAXMSGLEN + CRC_SZ];
+	uint8 ucaExpected[MAXMSGLEN + CRC_SZ];
+	uint8 ucaFrame[HOST_FRAME_MAX];
+	unsigned int uiValue;
+	uint8 ucPending;
+	int iLength;
+	int iOffset;
+	int iIdx;
+
+	pFile = pHost_Open(pcDir, "cp_traces.txt");
+	if (pFile == NULL)
+		return;
+
+	ucPending = 0;
+	while (ucHost_NextLine(pFile, cLine))
+	{
+		if (sscanf(cLine, "%7s %n", cKind, &iOffset) != 1)
+			continue;
+
+		if (strcmp(cKind, "stm") == 0)
+		{
+			if (sscanf(&cLine[iOffset], "%u %n", &uiValue, &iIdx) != 1)
+			{
+				HOST_CHECK(0, "no channel");
+				continue;
+			}
+			iLength = iHost_ParseHex(&cLine[iOffset + iIdx], ucaFrame, sizeof(ucaFrame));
+			HOST_CHECK(iLength > 0, "the frame bytes do not read");
+			if (iLength > 0)
+				vHost_QueueFrame(uiValue, ucaFrame, iLength);
+		}
+		else if (strcmp(cKind, "supply") == 0)
+		{
+			uiValue = 0;
+			sscanf(&cLine[iOffset], "%u", &uiValue);
+			vHost_SetSupply(uiValue);
+		}
+		else if (strcmp(cKind, "cp") == 0)
+		{
+			HOST_CHECK(!ucPending, "the last reply of the SP is not in the trace");
+
+			iLength = iHost_ParseHex(&cLine[iOffset], ucaRequest, sizeof(ucaRequest));
+			if ((iLength < SP_HEADERSIZE + CRC_SZ) || (ucaRequest[MSG_LEN_IDX] + CRC_SZ != iLength))
+			{
+				HOST_CHECK(0, "not a message with its CRC");
+				continue;
+			}
+			HOST_CHECK(ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_REC, ucaRequest, iLength) == 1, "the CRC of the CP is not good");
+
+			vHost_HandleMessage(ucaRequest, ucaReply);
+			ucPending = (ucaReply[MSG_LEN_IDX] != 0);
+			if (ucPending)
+				ucCRC16_compute_msg_CRC(CRC_FOR_MSG_TO_SEND, ucaReply, ucaReply[MSG_LEN_IDX] + CRC_SZ);
+		}
+		else if (strcmp(cKind, "sp") == 0)
+		{
+			iLength = iHost_ParseHex(&cLine[iOffset], ucaExpected, sizeof(ucaExpected));
+			HOST_CHECK(ucPending, "the SP sent nothing");
+			if (!ucPending)
+				continue;
+			ucPending = 0;
+
+			if ((iLength == ucaReply[MSG_LEN_IDX] + CRC_SZ) && (memcmp(ucaReply, ucaExpected, iLength) == 0))
+			{
+				g_uiHost_Checks++;
+				continue;
+			}
+
+			HOST_CHECK(0, "the reply differs");
+			printf("  sent:    ");
+			for (iIdx = 0; iIdx < ucaReply[MSG_LEN_IDX] + CRC_SZ; iIdx++)
+				printf(" %02X", ucaReply[iIdx]);
+			printf("\n  expected:");
+			for (iIdx = 0; iIdx < iLength; iIdx++)
+				printf(" %02X", ucaExpected[iIdx]);
+			printf("\n");
+		}
+		else
+		{
+			HOST_CHECK(0, "unknown line \"%s\"", cKind);
+		}
+	}
+	HOST_CHECK(!ucPending, "the last reply of the SP is not in the trace");
+
+	fclose(pFile);
+}
+
+int main(int argc, char **argv)
+{
+	const char *pcDir;
+
+	pcDir = (argc > 1) ? argv[1] : "fixtures";
+
+	vHost_TestCRC();
+	vHost_TestRetryBudget();
+	vHost_TestFrames(pcDir);
+	vHost_TestTrace(pcDir);
+
+	printf("%u checks, %u failed\n", g_uiHost_Checks, g_uiHost_Failures);
+
+	return (g_uiHost_Failures != 0);
+}
+
+//! @}
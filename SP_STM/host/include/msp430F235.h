@@ -0,0 +1,6 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file msp430F235.h
+//! \brief Stand in for the TI device header in the host build, see msp430x23x.h
+///////////////////////////////////////////////////////////////////////////////
+
+#include "msp430x23x.h"
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+//! \file msp430x23x.h
+//! \brief Stand in for the TI device header in the host build
+//!
+//! The intrinsics do nothing and the registers are plain variables defined in
+//! host_regs.c, so a module that touches them links and can be checked on
+//! the variables afterwards.  Only what the modules of the host build use is
+//! declared here, add to it with the module that needs more.
+//!
+//! @addtogroup host Host Build
+//! @{
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HOST_MSP430X23X_H_
+  #define HOST_MSP430X23X_H_
+
+  //! @name Intrinsics
+  //! @{
+  #define __interrupt
+  #define __disable_interrupt()				((void) 0)
+  #define __enable_interrupt()				((void) 0)
+  #define __no_operation()					((void) 0)
+  #define __delay_cycles(x)					((void) (x))
+  #define __bis_SR_register(x)				((void) (x))
+  #define __bic_SR_register(x)				((void) (x))
+  #define __bic_SR_register_on_exit(x)		((void) (x))
+  #define __even_in_range(x, y)				(x)
+  //! @}
+
+  //! @name Status Register Bits
+  //! @{
+  #define GIE			0x0008
+  #define CPUOFF		0x0010
+  #define OSCOFF		0x0020
+  #define SCG0			0x0040
+  #define SCG1			0x0080
+  #define LPM0_bits		(CPUOFF)
+  #define LPM3_bits		(SCG1 + SCG0 + CPUOFF)
+  //! @}
+
+  //! @name Bits
+  //! @{
+  #define BIT0			0x01
+  #define BIT1			0x02
+  #define BIT2			0x04
+  #define BIT3			0x08
+  #define BIT4			0x10
+  #define BIT5			0x20
+  #define BIT6			0x40
+  #define BIT7			0x80
+  //! @}
+
+  //! @name Clock and Watchdog Bits
+  //! @{
+  #define WDTPW			0x5A00
+  #define WDTHOLD		0x0080
+  #define XT2OFF		0x80
+  #define XTS			0x40
+  #define DIVA_2		0x20
+  #define SELM_0		0x00
+  #define DIVM_0		0x00
+  #define DIVS_2		0x04
+  #define LFXT1S_2		0x20
+  //! @}
+
+  //! @name Registers
+  //! Defined in host_regs.c
+  //! @{
+  extern volatile unsigned char P1IN, P1OUT, P1DIR, P1IFG, P1IES, P1IE, P1SEL, P1REN;
+  extern volatile unsigned char P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL, P2REN;
+  extern volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL, P3REN;
+  extern volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL, P4REN;
+  extern volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL, P5REN;
+  extern volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL, P6REN;
+  extern volatile unsigned char DCOCTL, BCSCTL1, BCSCTL2, BCSCTL3;
+  extern const volatile unsigned char CALDCO_16MHZ, CALBC1_16MHZ;
+  extern volatile unsigned int WDTCTL;
+  extern volatile unsigned int TACTL, TAR, TACCTL0, TACCR0;
+  extern volatile unsigned int TBCTL, TBR, TBCCTL0, TBCCR0;
+  //! @}
+
+#endif /*HOST_MSP430X23X_H_*/
+//! @}
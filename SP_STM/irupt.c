@@ -20,8 +20,20 @@ extern char g_ucaSTM_RXBuffer[RX_BUFFER_SIZE_STM];
 extern volatile char g_ucSTM_RXBufferIndex;
 extern char ISR;
 extern char ADCISRindicator;
-extern char timeoutcounter;
+extern volatile uint8 g_ucSTM_Event;
+extern uint16 g_uiSTM_DeadlineMsLeft;
 extern volatile uint8 g_ucCOMM_Flags;
+extern const uint8 g_ucaSTM_RXBits[NUM_STM_CHANNELS];
+extern const uint8 g_ucaSTM_ExciteBits[NUM_STM_CHANNELS];
+extern uint8 g_ucSTM_RXChannelIdx;
+extern S_STM_BatchChannel g_saSTM_BatchChannel[NUM_STM_CHANNELS];
+extern volatile uint8 g_ucSTM_BatchActive;
+extern volatile uint32 g_ulMain_Seconds;
+extern S_Sched_Timer g_saSched_Timer[SCHED_NUM_TIMERS];
+extern volatile uint8 g_ucSched_Expired;
+extern volatile uint16 g_uiPWR_SupplySum;
+extern volatile uint8 g_ucPWR_SupplyBusy;
+extern volatile uint8 g_ucPWR_SupplyWait;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -32,6 +44,17 @@ extern volatile uint8 g_ucCOMM_Flags;
 //!   then finish. If more bytes are to be sent, a new IO interrupt will be
 //!   called when the start bit comes. The byte index is incremented.
 //!
+//!   TimerB free runs in continuous mode.  Every bit time is scheduled by
+//!   adding one bit period to TBCCR1, so the CPU sleeps between the samples
+//!   and the timer is never stopped or cleared while receiving.
+//!
+//!   During a batch acquisition TBCCR1 instead runs the batch sampler. It
+//!   ticks at STM_BATCH_OVERSAMPLE times the baud rate, reads all the RX lines
+//!   with a single port read and runs a small receiver for each active channel.
+//!
+//!   TBCCR2 runs the millisecond deadline set by vSTM_StartDeadline() and
+//!   raises STM_EVENT_TIMEOUT when it passes.
+//!
 //!   \param none
 //!
 //!   \return none
@@ -39,6 +62,15 @@ extern volatile uint8 g_ucCOMM_Flags;
 #pragma vector=TIMERB1_VECTOR
 __interrupt void TIMERB1_ISR(void)
 {
+	uint8 ucPortSample;
+	uint8 ucChannelIdx;
+	uint8 ucChannelBit;
+	uint16 uiChunkMs;
+	S_STM_BatchChannel *pChannel;
+	uint8 ucDone;
+#if DIAG_ENABLED
+	uint16 uiParseStart;
+#endif
 
 	switch (__even_in_range(TBIV, 14))
 	{
@@ -47,19 +79,111 @@ __interrupt void TIMERB1_ISR(void)
 		break;
 
 		case TBIV_TBCCR1: /* TBCCR1_CCIFG */
+			if (g_ucSTM_BatchActive)
+			{
+				// Schedule the next tick without stopping the timer and latch all RX lines at once
+				TBCCR1 += STM_BATCH_TICK;
+				ucPortSample = P_STM_RX_IN;
+
+				for (ucChannelIdx = 0; ucChannelIdx < NUM_STM_CHANNELS; ucChannelIdx++)
+				{
+					ucChannelBit = 1 << ucChannelIdx;
+					if (!(g_ucSTM_BatchActive & ucChannelBit))
+						continue;
+
+					pChannel = &g_saSTM_BatchChannel[ucChannelIdx];
+
+					// Idle, look for the falling edge of a start bit
+					if (pChannel->m_ucBitsLeft == 0)
+					{
+						if (!(ucPortSample & g_ucaSTM_RXBits[ucChannelIdx]))
+						{
+							pChannel->m_ucTicks = STM_BATCH_FIRST_SAMPLE;
+							pChannel->m_ucBitsLeft = STM_BITS_PER_FRAME;
+
+							// When the frame started, for the timing profile
+							if (g_saSTM_Parser[ucChannelIdx].m_ucCount == 0)
+								g_saSTM_Parser[ucChannelIdx].m_uiEdgeMsLeft = STM_DEADLINE_MS_LEFT();
+						}
+						continue;
+					}
+
+					// Only sample in the middle of a bit
+					if (--pChannel->m_ucTicks != 0)
+						continue;
+
+					pChannel->m_ucTicks = STM_BATCH_OVERSAMPLE;
+
+					// Data bits come LSB first
+					if (--pChannel->m_ucBitsLeft != 0)
+					{
+						pChannel->m_ucShift >>= 1;
+						if (ucPortSample & g_ucaSTM_RXBits[ucChannelIdx])
+							pChannel->m_ucShift |= 0x80;
+						continue;
+					}
+
+					// Stop bit, parse the byte and go back to waiting for a start bit
+					// The channel is done once the parser has the whole frame
+#if DIAG_ENABLED
+					uiParseStart = TBR;
+#endif
+					ucDone = ucSTM_ParseByte(ucChannelIdx, pChannel->m_ucShift);
+					DIAG_RECORD(DIAG_PHASE_STM_PARSE, (uint16) (TBR - uiParseStart));
+
+					// The sensor is not needed past the end of its frame
+					if (ucDone)
+					{
+						g_ucSTM_BatchActive &= ~ucChannelBit;
+						P_STM_PWR_OUT &= ~g_ucaSTM_ExciteBits[ucChannelIdx];
+					}
+				}
+
+				// Wake up the foreground once every channel is finished
+				if (!g_ucSTM_BatchActive)
+				{
+					TBCCTL1 &= ~CCIE;
+					g_ucSTM_Event |= STM_EVENT_FRAME;
+					__bic_SR_register_on_exit(LPM4_bits);
+				}
+				break;
+			}
+
 			if (g_ucSTM_RXBusy)
 			{
-				TBCTL |= TBCLR; //Clear
-				TBCTL |= MC1; //Continuous Mode
+				// Schedule the next bit from this compare so the timer never has to stop
+				TBCCR1 += BAUD_1200;
 
 				switch (g_ucSTM_RXBitsLeft)
 				{
 					case 0x00:
-						// There are no bits left, so lets reset all the values and stop timer
-						P_STM_RX_IE |= cSTM_RX_Pin;
-						P_STM_RX_IFG &= ~cSTM_RX_Pin;
-						g_ucSTM_RXBufferIndex++;
+						// This is the middle of the stop bit, stop sampling and parse the byte
+						TBCCTL1 &= ~CCIE;
 						g_ucSTM_RXBusy = 0;
+
+#if DIAG_ENABLED
+						uiParseStart = TBR;
+#endif
+						ucDone = ucSTM_ParseByte(g_ucSTM_RXChannelIdx, g_ucaSTM_RXBuffer[g_ucSTM_RXBufferIndex]);
+						DIAG_RECORD(DIAG_PHASE_STM_PARSE, (uint16) (TBR - uiParseStart));
+
+						if (ucDone)
+						{
+							// The frame is finished, turn the sensor off and wake the foreground to pick up the result
+							P_STM_PWR_OUT &= ~g_ucaSTM_ExciteBits[g_ucSTM_RXChannelIdx];
+							g_ucSTM_Event |= STM_EVENT_FRAME;
+							__bic_SR_register_on_exit(LPM4_bits);
+						}
+						else
+						{
+							// Look for the next start bit
+							P_STM_RX_IFG &= ~cSTM_RX_Pin;
+							P_STM_RX_IE |= cSTM_RX_Pin;
+						}
+
+						// The buffer only keeps the raw frame, the last byte is overwritten if it runs on
+						if (g_ucSTM_RXBufferIndex < (RX_BUFFER_SIZE_STM - 1))
+							g_ucSTM_RXBufferIndex++;
 					break;
 
 					case 0x01:
@@ -85,8 +209,20 @@ __interrupt void TIMERB1_ISR(void)
 		break;
 
 		case TBIV_TBCCR2: /* TBCCR2_CCIFG */
-			__no_operation();
-			__bic_SR_register_on_exit(LPM4_bits);
+			if (g_uiSTM_DeadlineMsLeft)
+			{
+				// Arm the next part of a long deadline, the CPU keeps sleeping
+				uiChunkMs = (g_uiSTM_DeadlineMsLeft > STM_DEADLINE_CHUNK_MS) ? STM_DEADLINE_CHUNK_MS : g_uiSTM_DeadlineMsLeft;
+				g_uiSTM_DeadlineMsLeft -= uiChunkMs;
+				TBCCR2 += uiChunkMs * STM_TICKS_PER_MS;
+			}
+			else
+			{
+				// The deadline passed
+				TBCCTL2 &= ~CCIE;
+				g_ucSTM_Event |= STM_EVENT_TIMEOUT;
+				__bic_SR_register_on_exit(LPM4_bits);
+			}
 		break;
 
 		case TBIV_3: /* Reserved */
@@ -96,6 +232,10 @@ __interrupt void TIMERB1_ISR(void)
 		break;
 
 		case TBIV_TBIFG:
+#if DIAG_ENABLED
+			// High word of the diagnostics clock
+			g_uiDiag_Overflows++;
+#endif
 		break;
 
 	}
@@ -106,6 +246,9 @@ __interrupt void TIMERB1_ISR(void)
 //!
 //! Used for both transducer debugging and bit-banging
 //!
+//! The falling edge of an STM start bit only timestamps the edge and arms
+//! TBCCR1, the CPU stays asleep until the byte has been received.
+//!
 //!   \param none
 //!   \return none
 ///////////////////////////////////////////////////////////////////////////////
@@ -114,41 +257,32 @@ __interrupt void PORT1_ISR(void)
 {
 	if (P1IFG & SDA_PIN) {
 		P_SDA_IFG &= ~SDA_PIN;
+
+		// Tell ucCOMM_WaitForStartCondition() this was the CP and not an event
+		g_ucCOMM_Flags |= COMM_START_CONDITION;
 		__bic_SR_register_on_exit(LPM4_bits);
 	}
 
-	if (P_STM_RX_IFG & cSTM_RX_Pin)
+	// The flag latches with the edge interrupt off, and the batch sampler in
+	// TIMERB1_ISR owns the RX pins, so only an armed edge of a single read counts
+	if ((P_STM_RX_IFG & cSTM_RX_Pin) && (P_STM_RX_IE & cSTM_RX_Pin) && !g_ucSTM_BatchActive)
 	{
-		timeoutcounter = 0;
-		// Delay for half bit, this ensures we start sampling at the middle of
-		// each bit
-		TBCTL &= ~(MC0 | MC1 | TBIE | TBIFG); //Halt timer, Disable interrupts
-		TBCTL |= TBCLR; //Clear Timer
-		TBCCTL1 &= ~CCIFG;
-		TBCCTL1 &= ~CCIE; //Disable Compare interrupt
-		TBCCTL0 &= ~CCIE; //Disable Compare interrupt
-		TBCCR0 = BAUD_1200_DELAY; //Input delay time in compare register
-		TBCTL |= MC_1; //Start timer in UP Mode (Counts to TBCCR0 then starts at 0 again)
-		while (!(TBCTL & TBIFG)); //Wait until Compare register is met
-		TBCTL &= ~TBIFG;
-		// Enable timer interrupt, configure for baud rate
-		TBCTL &= ~(MC0 | MC1); //Halt timer
-		TBCTL |= TBCLR; //Clear
-		TBCCTL1 |= CCIE;
-		TBCCR0 = 0;
-		TBCCR1 = BAUD_1200;
-		__bic_SR_register_on_exit(LPM4_bits);
-		//All Clocks and CPU etc awake now that we received a start bit.
-		// Disable interrupt on RX
+		// Timestamp the start edge and schedule the compare for the middle of the
+		// first data bit.  The timer keeps running so there is nothing to wait for here.
+		TBCCR1 = TBR + STM_FIRST_BIT_DELAY;
+		TBCCTL1 = CCIE; // Clears any stale CCIFG as well
+
+		// Disable interrupt on RX until the stop bit
 		P_STM_RX_IE &= ~cSTM_RX_Pin;
 		P_STM_RX_IFG &= ~cSTM_RX_Pin;
 		//*****************
 		g_ucSTM_RXBitsLeft = 0x08;
 		g_ucSTM_RXBusy = 1;
 		//*****************
-		TBCTL |= MC1; //Continuous Mode
-		//Clear Interrupt Flag
-		TBCCTL1 &= ~TBIFG; //IFG
+
+		// When the frame started, for the timing profile
+		if (g_saSTM_Parser[g_ucSTM_RXChannelIdx].m_ucCount == 0)
+			g_saSTM_Parser[g_ucSTM_RXChannelIdx].m_uiEdgeMsLeft = STM_DEADLINE_MS_LEFT();
 
 	} //END if(P_STM_RX_IFG & cSTM_1_RX_PIN)//P2IFG & BIT4
 }
@@ -184,6 +318,38 @@ __interrupt void PORT2_ISR(void)
 
 } //END __interrupt void PORT2_ISR(void)
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief ADC12 ISR, the end of a supply conversion
+//!
+//! Adds the sample to the running average and turns the ADC and the reference
+//! off to save power.  The first sample seeds the average.
+//!   \param None
+//!   \return None
+//!   \sa vPWR_StartSupply()
+///////////////////////////////////////////////////////////////////////////////
+#pragma vector=ADC12_VECTOR
+__interrupt void ADC12_ISR(void)
+{
+	uint16 uiVolts;
+
+	uiVolts = ADC12MEM15; //(0.5*Vin)/2.5V * 4095, reading it clears the IFG
+	ADC12CTL0 &= ~ENC;
+	ADC12CTL0 &= ~(REFON + ADC12ON); // turn off A/D to save power
+	ADC12IE &= ~ADC12IE15;
+
+	uiVolts = (uiVolts * 5) / 41;
+
+	if (g_uiPWR_SupplySum == 0)
+		g_uiPWR_SupplySum = uiVolts << PWR_SUPPLY_AVG_SHIFT;
+	else
+		g_uiPWR_SupplySum += uiVolts - (g_uiPWR_SupplySum >> PWR_SUPPLY_AVG_SHIFT);
+
+	g_ucPWR_SupplyBusy = 0;
+
+	if (g_ucPWR_SupplyWait)
+		__bic_SR_register_on_exit(LPM0_bits);
+}
+
 #pragma vector=COMPARATORA_VECTOR
 __interrupt void COMPARATORA_ISR(void)
 {}
@@ -192,6 +358,38 @@ __interrupt void COMPARATORA_ISR(void)
 __interrupt void NMI_ISR(void)
 {}
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief TimerA CCR0 ISR, the one second tick of the scheduler
+//!
+//! Counts down every running software timer and posts the event of each one
+//! that expires, which wakes the core from LPM3.
+//!   \param None
+//!   \return None
+//!   \sa vSched_StartTimer(), vSched_Run()
+///////////////////////////////////////////////////////////////////////////////
+#pragma vector=TIMERA0_VECTOR
+__interrupt void TIMERA0_ISR(void)
+{
+	uint8 ucIdx;
+	S_Sched_Timer *pTimer;
+
+	g_ulMain_Seconds++;
+
+	for (ucIdx = 0; ucIdx < SCHED_NUM_TIMERS; ucIdx++)
+	{
+		pTimer = &g_saSched_Timer[ucIdx];
+		if (pTimer->m_uiPeriod == 0)
+			continue;
+
+		if (--pTimer->m_uiCountdown == 0)
+		{
+			pTimer->m_uiCountdown = pTimer->m_uiPeriod;
+			g_ucSched_Expired |= (1 << ucIdx);
+			SCHED_POST_FROM_ISR(pTimer->m_ucEvent);
+		}
+	}
+}
+
 #pragma vector=TIMERA1_VECTOR
 __interrupt void TIMERA1_ISR(void)
 {}
@@ -28,7 +28,8 @@ MEMORY
     INFOB                   : origin = 0x1080, length = 0x0040
     INFOC                   : origin = 0x1040, length = 0x0040
     INFOD                   : origin = 0x1000, length = 0x0040
-    FLASH                   : origin = 0xC000, length = 0x3FDE
+    LOG                     : origin = 0xC000, length = 0x0800
+    FLASH                   : origin = 0xC800, length = 0x37DE
     INT00                   : origin = 0xFFE0, length = 0x0002
     INT01                   : origin = 0xFFE2, length = 0x0002
     INT02                   : origin = 0xFFE4, length = 0x0002
@@ -56,7 +57,11 @@ SECTIONS
     .bss        : {} > RAM                /* GLOBAL & STATIC VARS              */
     .data       : {} > RAM                /* GLOBAL & STATIC VARS              */
     .sysmem     : {} > RAM                /* DYNAMIC MEMORY ALLOCATION AREA    */
-    .stack      : {} > RAM (HIGH)         /* SOFTWARE SYSTEM STACK             */
+    GROUP                                 /* SOFTWARE SYSTEM STACK             */
+    {                                     /* WITH THE PAINTED GUARD BELOW IT   */
+        .stackguard : {}
+        .stack      : {}
+    } > RAM (HIGH)
 
     .text       : {} > FLASH              /* CODE                              */
     .cinit      : {} > FLASH              /* INITIALIZATION TABLES             */
@@ -59,11 +59,36 @@ char cSTM_Initialized = 0;
 #define TYPE_IS_ACTUATOR	0x41 //ascii A
 //!@}
 
+//! \struct S_Transducer
+//! \brief Describes one transducer, see g_saMain_Transducers
+typedef struct S_Transducer
+{
+	const char *m_pcLabel;		//!< TRANSDUCER_LABEL_LEN characters
+	uint16 (*m_pfnHandler)(const struct S_Transducer *psTrans, uint8 *ucParam);	//!< Takes the measurement
+	uint8 m_ucChannel;				//!< STM channel, 0 if the transducer is not an STM
+	uint8 m_ucSoilGen;				//!< S_Report index of the soil moisture (or only) data
+	uint8 m_ucTempGen;				//!< S_Report index of the temperature data
+	uint8 m_ucSpreadGen;			//!< S_Report index of the spread of the soil moisture, 0 if none
+	uint8 m_ucType;						//!< TYPE_IS_SENSOR or TYPE_IS_ACTUATOR
+	uint8 m_ucSampleDuration;	//!< Seconds a sample takes until it has been measured
+} S_Transducer;
+
 //! @name SP Board data structure
 //! @{
 //! \def NUMDATGEN
-//! \brief The number of data generating elements on this board 2 per sensor plus one for the diagnostics
-#define NUMDATGEN		0x09
+//! \brief The number of data generating elements on this board 2 per sensor plus one for the diagnostics,
+//! one for the supply voltage and one for the spread of each sensor
+#define NUMDATGEN		0x0E
+
+//! \def SUPPLY_GEN
+//! \brief The data generator of the supply voltage * 100, only sent in packed reports
+#define SUPPLY_GEN		0x09
+
+//! \def SPREAD_GEN
+//! \brief The data generator of the spread of STM1, see uiSTM_GetSpread(), only sent in packed reports
+//!
+//! The generators of the other STMs follow.
+#define SPREAD_GEN		0x0A
 
 //! \def MAXDATALEN
 //! \brief This is the maximum length of a sensor reading for this board in bytes
@@ -73,62 +98,125 @@ char cSTM_Initialized = 0;
 //! \brief Flag indicating that new data is loaded into the S_Report structure
 #define F_NEWDATA		0x01
 
+//! \def F_RAWDATA
+//! \brief Flag indicating that the data is an error code and not a number
+#define F_RAWDATA		0x02
+
 //! \struct S_Report
 //! \brief Customizable struct provides a generalized interface between data generators and the core
 struct{
 		uint8 m_ucaData[MAXDATALEN];	//!< Holds information from a data generator
 		uint8 m_ucLength;							//!< Length of the data in the m_ucaData array (in bytes)
 		uint8 m_ucFlags;							//!< Flags
+		uint32 m_ulTimestamp;					//!< g_ulMain_Seconds when the data was taken
 }S_Report[NUMDATGEN];
 //! @}
 
-//! \var g_iVLOCal
-//! \brief Calibration constant for the VLO.
-//!This constant is the number of ticks required calibrate the VLO based on the typical frequency of 12000
-signed int g_iVLOCal;
+//! @name Background Sampling Variables
+//! Index 0 is transducer 1.
+//! @{
+//! \var g_ulMain_Seconds
+//! \brief Seconds counted by the sampling clock, used to time stamp S_Report
+volatile uint32 g_ulMain_Seconds;
 
-//! \var g_ucEventTrigger
-//! \brief Flag indicating that an application specific event has occured and requires handling
-unsigned char g_ucEventTrigger;
+//! \var g_uiaMain_SampleInterval
+//! \brief Seconds between background samples of each transducer, 0 = off, as kept in the config store
+uint16 g_uiaMain_SampleInterval[NUM_SAMPLED_TRANSDUCERS];
+//! @}
 
-///////////////////////////////////////////////////////////////////////////////
-//! \fn vMain_CalibrateVLO
-//! \brief Generates a calibration constant for the VLO
+//! @name Threshold Notify
+//! A background sample of a transducer with a threshold is compared against
+//! it, crossing it by more than the hysteresis has the CP notified.  The soil
+//! value is the water content for a 5TM or 5TE, otherwise the value as
+//! decoded, limited to 16 bits.
+//! @{
+#define MAIN_THRESHOLD_OFF		0xFFFF	//!< Hysteresis of a transducer without a threshold, as erased
+#define MAIN_SIDE_UNKNOWN		0		//!< No sample since the threshold was set
+#define MAIN_SIDE_BELOW			1		//!< The last sample outside the band was below it
+#define MAIN_SIDE_ABOVE			2		//!< The last sample outside the band was above it
+
+//! \var g_uiaMain_Threshold
+//! \brief Threshold and hysteresis of each sampled transducer, as kept in the config store
+uint16 g_uiaMain_Threshold[2 * NUM_SAMPLED_TRANSDUCERS];
+
+//! \var g_ucaMain_Side
+//! \brief The side of the threshold each sampled transducer is on
+uint8 g_ucaMain_Side[NUM_SAMPLED_TRANSDUCERS];
+//! @}
+
+#if COMM_SEGMENTED_ENABLED
+//! @name Describe Cache
+//! The payload of the segmented INTERROGATE and REQUEST_LABEL replies is
+//! built once and sent from RAM.  It is the number of transducers and then
+//! for each of transducer 1 on: the type, the sensor type, the sample
+//! duration in ms low byte first and the label.
+//! @{
+#define MAIN_DESCRIBE_ENTRY_LEN	(4 + TRANSDUCER_LABEL_LEN)	//!< Bytes per transducer
+#define MAIN_DESCRIBE_MS_IDX	2							//!< Offset of the sample duration in an entry
+#define MAIN_DESCRIBE_LEN		(1 + NUM_TRANSDUCERS * MAIN_DESCRIBE_ENTRY_LEN)
+
+//! \var g_ucaMain_Describe
+//! \brief The cached payload
+uint8 g_ucaMain_Describe[MAIN_DESCRIBE_LEN];
+
+//! \var g_ucMain_DescribeGen
+//! \brief ucSTM_GetTypeGen() when g_ucaMain_Describe was built
+uint8 g_ucMain_DescribeGen;
+//! @}
+#endif
+
+//! @name Packed Report Variables
+//! The values the CP holds after the last packed REPORT_DATA
+//! @{
+//! \var g_laMain_PackedRef
+//! \brief The last value sent of each data generator
+int32 g_laMain_PackedRef[NUMDATGEN];
+
+//! \var g_uiMain_PackedRefMask
+//! \brief Mask of the generators in g_laMain_PackedRef the CP has, bit n = generator n
+uint16 g_uiMain_PackedRefMask;
+
+//! \var g_ucMain_PackedSeq
+//! \brief The report number of the last packed REPORT_DATA
+uint8 g_ucMain_PackedSeq;
+
+//! \var g_uiMain_DDITempMask
+//! \brief Mask of the generators holding the raw temperature of a 5TM or 5TE, bit n = generator n
 //!
-//! The SP-CM-STM board uses the VLO to time the duration the valve is on while
-//! allowing the board to remain in LPM3
+//! S_Report keeps these as sent for the v1.20 REPORT_DATA, the packed one
+//! decodes them, see the STM Decoders.
+uint16 g_uiMain_DDITempMask;
+//! @}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the time on the sampling clock
 //!
-//! The VLO frequency should be 12 kHz, but it can range from 4 kHZ to 20 kHz.
-//! Therefore, we must determine a calibration constant before it can be used.
-//! Two timers, timer A sourced from the SMCLK and timer B from the VLO (through ACLK)
-//! run for 8.333 mS.  TBR should equal 100 ticks assuming the frequency of
-//! the VLO is 12 kHz.  The deviation from 100 is measured and scaled up to the deviation
-//! in ticks the VLO is from a full second of 12000 ticks.
+//! The counter is 32 bits and updated from TIMERA0_ISR so it is copied with
+//! interrupts off.
 //!
+//! \return g_ulMain_Seconds
 ///////////////////////////////////////////////////////////////////////////////
-void vMain_CalibrateVLO(void){
-
-	// Set ACLK divider to 1
-	BCSCTL1 &= ~DIVA_3;
-
-	// Determine VLO calibration constant to improve accuracy
-	TACTL = (TASSEL_2 | TACLR | ID_2);
-	TACCR0 = 8333;
-	TBCTL = (TBSSEL_1 | TBCLR );
-	TACTL |= MC_1;
-	TBCTL |= MC_2;
-	while((TACCTL0 & CCIFG) == 0);
-
-	// Set the global cal constant
-	g_iVLOCal = (signed int)(TBR - 100)*120;
+uint32 ulMain_GetSeconds(void)
+{
+	uint32 ulSeconds;
 
-	TACTL = TACLR;
-	TBCTL = TBCLR;
-	TACCR0 = 0;
+	__disable_interrupt();
+	ulSeconds = g_ulMain_Seconds;
+	__enable_interrupt();
 
-	// Set ACLK divider back to 4
-	BCSCTL1 |= DIVA_2;
+	return ulSeconds;
+}
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Appends the data of a generator to the measurement log
+//!
+//! \param ucDataGen, the index into S_Report
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vMain_LogReport(uint8 ucDataGen)
+{
+	ucLog_Append(ucDataGen, S_Report[ucDataGen].m_ucLength, S_Report[ucDataGen].m_ulTimestamp,
+			S_Report[ucDataGen].m_ucaData);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -141,27 +229,42 @@ void vMain_CalibrateVLO(void){
 //!
 //! 0000
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-uint16 uiMain_Test(uint8 *ucParam)
+static uint16 uiMain_Test(const S_Transducer *psTrans, uint8 *ucParam)
 {
-	S_Report[0].m_ucaData[0] = 0xBE;
-	S_Report[0].m_ucaData[1] = 0xEF;
-	S_Report[0].m_ucLength = 2;
-	S_Report[0].m_ucFlags = F_NEWDATA;
+	S_Report[psTrans->m_ucSoilGen].m_ucaData[0] = 0xBE;
+	S_Report[psTrans->m_ucSoilGen].m_ucaData[1] = 0xEF;
+	S_Report[psTrans->m_ucSoilGen].m_ucLength = 2;
+	S_Report[psTrans->m_ucSoilGen].m_ucFlags = F_NEWDATA;
+	S_Report[psTrans->m_ucSoilGen].m_ulTimestamp = ulMain_GetSeconds();
 
 	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Handle for when Transducer 1 is called
+//!   \brief Handle for when an STM transducer is called
+//!
+//! The soil moisture goes to the first data generator of the transducer and
+//! the temperature to the second.  With a burst these are the medians of the
+//! good frames and the spread goes to the third, which is left empty for a
+//! single frame.
 //!
-//!   \param *ucParam, parameters if required
+//!   \param *psTrans, the transducer; *ucParam, parameters if required
 //!   \return 1: success, 0: failure
 ///////////////////////////////////////////////////////////////////////////////
-uint16 uiMain_STM1(uint8 *ucParam)
+static uint16 uiMain_STM(const S_Transducer *psTrans, uint8 *ucParam)
 {
 	int32 lSoil;
 	int16 iTemperature;
 	uint8 cResult;
+	uint8 ucSoil;
+	uint8 ucTemp;
+	uint8 ucSpread;
+	uint16 uiSpread;
+	uint8 ucSensorType;
+
+	ucSoil = psTrans->m_ucSoilGen;
+	ucTemp = psTrans->m_ucTempGen;
+	ucSpread = psTrans->m_ucSpreadGen;
 
 	if (!cSTM_Initialized)
 	{
@@ -169,7 +272,8 @@ uint16 uiMain_STM1(uint8 *ucParam)
 		cSTM_Initialized = 1;
 	}
 
-	cResult = cSTM_Measure(1);
+	// The failed frames are counted by the STM module as they are dropped
+	cResult = cSTM_Measure(psTrans->m_ucChannel);
 
 	// Write information to the S_Report structure
 	if (cResult == 0)
@@ -179,399 +283,485 @@ uint16 uiMain_STM1(uint8 *ucParam)
 		iTemperature = iSTM_GetTemp();
 
 		// Start the report length at the maximum
-		S_Report[1].m_ucLength = 4;
+		S_Report[ucSoil].m_ucLength = 4;
 
 		// To avoid sending zeros at the high end of the ulSoil variable we check for the the first non-zero byte
 		if ((lSoil & 0xFF800000) == 0)
 		{
-			S_Report[1].m_ucLength--;
+			S_Report[ucSoil].m_ucLength--;
 			if ((lSoil & 0x00FF8000) == 0)
 			{
-				S_Report[1].m_ucLength--;
+				S_Report[ucSoil].m_ucLength--;
 				if ((lSoil & 0x0000FF80) == 0)
-					S_Report[1].m_ucLength--;
+					S_Report[ucSoil].m_ucLength--;
 			}
 		}
 		// Left shift the data over so that leading zeros are removed
-		lSoil = lSoil << (8 * (4-S_Report[1].m_ucLength));
-
-		S_Report[1].m_ucaData[0] = (uint8) (lSoil >> 24);
-		S_Report[1].m_ucaData[1] = (uint8) (lSoil >> 16);
-		S_Report[1].m_ucaData[2] = (uint8) (lSoil >> 8);
-		S_Report[1].m_ucaData[3] = (uint8) lSoil;
-
-		S_Report[2].m_ucaData[0] = (uint8) (iTemperature >> 8);
-		S_Report[2].m_ucaData[1] = (uint8) iTemperature;
-		S_Report[2].m_ucLength = 2;
+		lSoil = lSoil << (8 * (4-S_Report[ucSoil].m_ucLength));
+
+		S_Report[ucSoil].m_ucaData[0] = (uint8) (lSoil >> 24);
+		S_Report[ucSoil].m_ucaData[1] = (uint8) (lSoil >> 16);
+		S_Report[ucSoil].m_ucaData[2] = (uint8) (lSoil >> 8);
+		S_Report[ucSoil].m_ucaData[3] = (uint8) lSoil;
+
+		S_Report[ucTemp].m_ucaData[0] = (uint8) (iTemperature >> 8);
+		S_Report[ucTemp].m_ucaData[1] = (uint8) iTemperature;
+		S_Report[ucTemp].m_ucLength = 2;
+
+		// A 5TM or 5TE temperature stays raw here, the packed report decodes it
+		ucSensorType = cSTM_ReturnSensorType(psTrans->m_ucChannel);
+		if ((ucSensorType == FIVETM) || (ucSensorType == FIVETE))
+			g_uiMain_DDITempMask |= (1 << ucTemp);
+		else
+			g_uiMain_DDITempMask &= ~(1 << ucTemp);
+
+		// At most 0x7FFF so it reads back positive
+		uiSpread = uiSTM_GetSpread();
+		S_Report[ucSpread].m_ucaData[0] = (uint8) (uiSpread >> 8);
+		S_Report[ucSpread].m_ucaData[1] = (uint8) uiSpread;
+		S_Report[ucSpread].m_ucLength = 2;
 	}
-	else if (cResult == 1)// Checksum fail
+	else // Checksum fail or timeout, report the code
 	{
-		S_Report[1].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[1].m_ucLength = 1;
+		S_Report[ucSoil].m_ucaData[0] = cResult;
+		S_Report[ucSoil].m_ucLength = 1;
 
-		S_Report[2].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[2].m_ucLength = 1;
-	}
-	else if (cResult == 2)//Timeout
-	{
-		S_Report[1].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[1].m_ucLength = 1;
+		S_Report[ucTemp].m_ucaData[0] = cResult;
+		S_Report[ucTemp].m_ucLength = 1;
+
+		S_Report[ucSpread].m_ucaData[0] = cResult;
+		S_Report[ucSpread].m_ucLength = 1;
 
-		S_Report[2].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[2].m_ucLength = 1;
+		g_uiMain_DDITempMask &= ~(1 << ucTemp);
 	}
 
 	// Set the flags indicating there is data to report
-	S_Report[1].m_ucFlags = F_NEWDATA;
-	S_Report[2].m_ucFlags = F_NEWDATA;
+	S_Report[ucSoil].m_ucFlags = (cResult == 0) ? F_NEWDATA : (F_NEWDATA | F_RAWDATA);
+	S_Report[ucTemp].m_ucFlags = S_Report[ucSoil].m_ucFlags;
+	// The spread only goes out for a burst, it keeps the packed report short
+	S_Report[ucSpread].m_ucFlags = (ucSTM_GetBurst(psTrans->m_ucChannel) > 1) ? S_Report[ucSoil].m_ucFlags : 0;
+	S_Report[ucSoil].m_ulTimestamp = ulMain_GetSeconds();
+	S_Report[ucTemp].m_ulTimestamp = S_Report[ucSoil].m_ulTimestamp;
+	S_Report[ucSpread].m_ulTimestamp = S_Report[ucSoil].m_ulTimestamp;
+
+	// Keep the readings in case the CP misses them
+	vMain_LogReport(ucSoil);
+	vMain_LogReport(ucTemp);
 
 	return 0;
 }
 
+//! \var g_saMain_Transducers
+//! \brief The transducers of this board, indexed by transducer number
+//!
+//! Dispatch, labels, INTERROGATE and the measurements are all driven from
+//! here, a board with more STMs only needs more entries.  The power and RX
+//! pin of each STM channel are in g_ucaSTM_ExciteBits and g_ucaSTM_RXBits.
+const S_Transducer g_saMain_Transducers[NUM_TRANSDUCERS + 1] = {
+	// Label,					Handler,		Channel,	Soil,	Temp,	Spread,				Type,			Duration
+	{ TRANSDUCER_0_LABEL_TXT,	uiMain_Test,	0,			0,		0,		0,					0,				1 },
+	{ TRANSDUCER_1_LABEL_TXT,	uiMain_STM,		1,			1,		2,		SPREAD_GEN,			TYPE_IS_SENSOR,	1 },
+	{ TRANSDUCER_2_LABEL_TXT,	uiMain_STM,		2,			3,		4,		SPREAD_GEN + 1,		TYPE_IS_SENSOR,	1 },
+	{ TRANSDUCER_3_LABEL_TXT,	uiMain_STM,		3,			5,		6,		SPREAD_GEN + 2,		TYPE_IS_SENSOR,	1 },
+	{ TRANSDUCER_4_LABEL_TXT,	uiMain_STM,		4,			7,		8,		SPREAD_GEN + 3,		TYPE_IS_SENSOR,	1 }
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Handle for when Transducer 2 is called
 //!
-//!   \param *ucParam, parameters if required
-//!   \return 1: success, 0: failure
+//! \brief Initializes the data storage structure
+//!
+//! \param none
+//! \return none
 ///////////////////////////////////////////////////////////////////////////////
-uint16 uiMain_STM2(uint8 *ucParam)
+void vMain_CleanDataStruct(void)
 {
-	int32 lSoil;
-	int16 iTemperature;
-	uint8 cResult;
-
-	if (!cSTM_Initialized)
-	{
-		vSTM_Initialize();
-		cSTM_Initialized = 1;
-	}
-
-	cResult = cSTM_Measure(2);
-
-	// Write information to the S_Report structure
-	if (cResult == 0)
-	{
-		// Get the soil moisture and soil temperature readings
-		lSoil = lSTM_GetSoil();
-		iTemperature = iSTM_GetTemp();
+	uint8 ucDataGenCnt;
+	uint8 ucByteCnt;
 
-		// Start the report length at the maximum
-		S_Report[3].m_ucLength = 4;
+	// Clean out the data storage structure
+	for (ucDataGenCnt = 0; ucDataGenCnt < NUMDATGEN; ucDataGenCnt++) {
+		S_Report[ucDataGenCnt].m_ucFlags = 0;
+		S_Report[ucDataGenCnt].m_ucLength = 0;
+		S_Report[ucDataGenCnt].m_ulTimestamp = 0;
 
-		// To avoid sending zeros at the high end of the ulSoil variable we check for the the first non-zero byte
-		if ((lSoil & 0xFF800000) == 0)
-		{
-			S_Report[3].m_ucLength--;
-			if ((lSoil & 0x00FF8000) == 0)
-			{
-				S_Report[3].m_ucLength--;
-				if ((lSoil & 0x0000FF80) == 0)
-					S_Report[3].m_ucLength--;
-			}
+		for (ucByteCnt = 0; ucByteCnt < MAXDATALEN; ucByteCnt++) {
+			S_Report[ucDataGenCnt].m_ucaData[ucByteCnt] = 0;
 		}
-		// Left shift the data over so that leading zeros are removed
-		lSoil = lSoil << (8 * (4-S_Report[3].m_ucLength));
-
-		S_Report[3].m_ucaData[0] = (uint8) (lSoil >> 24);
-		S_Report[3].m_ucaData[1] = (uint8) (lSoil >> 16);
-		S_Report[3].m_ucaData[2] = (uint8) (lSoil >> 8);
-		S_Report[3].m_ucaData[3] = (uint8) lSoil;
-
-		S_Report[4].m_ucaData[0] = (uint8) (iTemperature >> 8);
-		S_Report[4].m_ucaData[1] = (uint8) iTemperature;
-		S_Report[4].m_ucLength = 2;
-
 	}
-	else if (cResult == 1)// Checksum fail
-	{
-		S_Report[3].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[3].m_ucLength = 1;
-
-		S_Report[4].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[4].m_ucLength = 1;
-
-	}
-	else if (cResult == 2)//Timeout
-	{
-		S_Report[3].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[3].m_ucLength = 1;
-
-		S_Report[4].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[4].m_ucLength = 1;
-	}
-
-	S_Report[3].m_ucFlags = F_NEWDATA;
-	S_Report[4].m_ucFlags = F_NEWDATA;
-
-	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Handle for when Transducer 3 is called
 //!
+//! \brief Loads the passed buffer with data stored in the S_Report structure
 //!
-//!   \param *ucParam, parameters if require
-//!   \return 1: success, 0: failure
+//! \param *pBuff
+//! \return ucLength, the amount of bytes added to the passed buffer
 ///////////////////////////////////////////////////////////////////////////////
-uint16 uiMain_STM3(uint8 *ucParam)
+uint8 ucMain_FetchData(volatile uint8 * pucBuff)
 {
-	int32 lSoil;
-	int16 iTemperature;
-	uint8 cResult;
-
-	if (!cSTM_Initialized)
-	{
-		vSTM_Initialize();
-		cSTM_Initialized = 1;
-	}
+	uint8 ucDataGenCnt;
+	uint8 ucByteCnt;
+	uint8 ucLength;
 
-	cResult =cSTM_Measure(3);
+	// Assume no data
+	ucLength = 0;
 
-	// Write information to the S_Report structure
-	if (cResult == 0)
+	// Check all the data generators for new data, the supply and the spreads are left to the packed format
+	for (ucDataGenCnt = 0; ucDataGenCnt < SUPPLY_GEN; ucDataGenCnt++)
 	{
-		// Get the soil moisture and soil temperature readings
-		lSoil = lSTM_GetSoil();
-		iTemperature = iSTM_GetTemp();
-
-		// Start the report length at the maximum
-		S_Report[5].m_ucLength = 4;
-
-		// To avoid sending zeros at the high end of the ulSoil variable we check for the the first non-zero byte
-		if ((lSoil & 0xFF800000) == 0)
+		// If there is new data to report then write to the passed buffer
+		if (S_Report[ucDataGenCnt].m_ucFlags & F_NEWDATA)
 		{
-			S_Report[5].m_ucLength--;
-			if ((lSoil & 0x00FF8000) == 0)
+			// write the data generator ID and the length of this message
+			*pucBuff++ = ucDataGenCnt;
+			*pucBuff++ = S_Report[ucDataGenCnt].m_ucLength;
+
+			// write the data
+			for (ucByteCnt = 0; ucByteCnt < S_Report[ucDataGenCnt].m_ucLength; ucByteCnt++)
 			{
-				S_Report[5].m_ucLength--;
-				if ((lSoil & 0x0000FF80) == 0)
-					S_Report[5].m_ucLength--;
+				*pucBuff++ = S_Report[ucDataGenCnt].m_ucaData[ucByteCnt];
 			}
+
+			// Update the length variable. Includes raw data, data generator ID, and length byte lengths
+			ucLength += (S_Report[ucDataGenCnt].m_ucLength + 2);
 		}
-		// Left shift the data over so that leading zeros are removed
-		lSoil = lSoil << (8 * (4-S_Report[5].m_ucLength));
+	}
 
-		S_Report[5].m_ucaData[0] = (uint8) (lSoil >> 24);
-		S_Report[5].m_ucaData[1] = (uint8) (lSoil >> 16);
-		S_Report[5].m_ucaData[2] = (uint8) (lSoil >> 8);
-		S_Report[5].m_ucaData[3] = (uint8) lSoil;
+return ucLength;
+}
 
-		S_Report[6].m_ucaData[0] = (uint8) (iTemperature >> 8);
-		S_Report[6].m_ucaData[1] = (uint8) iTemperature;
-		S_Report[6].m_ucLength = 2;
 
-	}
-	else if (cResult == 1)// Checksum fail
-	{
-		S_Report[5].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[5].m_ucLength = 1;
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Writes a varint, 7 bits per byte with the low group first
+//!
+//! \param *pucBuff, destination
+//! \param ulValue, the value
+//! \return The number of bytes written, 1 to 5
+///////////////////////////////////////////////////////////////////////////////
+static uint8 ucMain_PutVarint(volatile uint8 * pucBuff, uint32 ulValue)
+{
+	uint8 ucLength;
 
-		S_Report[6].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[6].m_ucLength = 1;
-	}
-	else if (cResult == 2)//Timeout
+	ucLength = 1;
+	while (ulValue >= 0x80)
 	{
-		S_Report[5].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[5].m_ucLength = 1;
-
-		S_Report[6].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[6].m_ucLength = 1;
+		*pucBuff++ = (uint8) ulValue | 0x80;
+		ulValue >>= 7;
+		ucLength++;
 	}
+	*pucBuff = (uint8) ulValue;
 
-	S_Report[5].m_ucFlags = F_NEWDATA;
-	S_Report[6].m_ucFlags = F_NEWDATA;
+	return ucLength;
+}
 
-	return 0;
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Returns the value of a data generator
+//!
+//! The data is stored big endian with the leading sign bytes removed, so it
+//! is sign extended from its first byte.
+//!
+//! \param ucDataGen, the index into S_Report
+//! \return The signed value
+///////////////////////////////////////////////////////////////////////////////
+static int32 lMain_ReportValue(uint8 ucDataGen)
+{
+	uint32 ulValue;
+	uint8 ucByteCnt;
+
+	ulValue = (uint32) (int32) (int8) S_Report[ucDataGen].m_ucaData[0];
+	for (ucByteCnt = 1; ucByteCnt < S_Report[ucDataGen].m_ucLength; ucByteCnt++)
+		ulValue = (ulValue << 8) | S_Report[ucDataGen].m_ucaData[ucByteCnt];
+
+	return (int32) ulValue;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//!   \brief Handle for when Transducer 4 is called
 //!
+//! \brief Loads the passed buffer with the S_Report data in the packed format
 //!
-//!   \param *ucParam, parameters if require
-//!   \return 1: success, 0: failure
+//! The format is described with REPORT_DATA.  Deltas are used only if every
+//! numeric entry has a value the CP already holds, otherwise the report is
+//! absolute and starts a new chain.
+//! The running average of the supply is attached as SUPPLY_GEN.  A 5TM or
+//! 5TE temperature goes out in degrees C x10, and from SP_PACKEDVWC_VERSION
+//! on the water contents of the 5TM and 5TE follow the entries.
+//!
+//! \param *pucBuff
+//! \param ucReqVersion, the version byte of the request, SP_PACKEDDATA_VERSION or later
+//! \return ucLength, the amount of bytes added to the passed buffer
 ///////////////////////////////////////////////////////////////////////////////
-uint16 uiMain_STM4(uint8 *ucParam)
+uint8 ucMain_FetchPackedData(volatile uint8 * pucBuff, uint8 ucReqVersion)
 {
-	int32 lSoil;
-	int16 iTemperature;
-	uint8 cResult;
+	const S_Transducer *psTrans;
+	uint8 ucDataGenCnt;
+	uint8 ucByteCnt;
+	uint8 ucLength;
+	uint8 ucAllowDelta;
+	uint8 ucTransNum;
+	uint8 ucVWCMask;
+	uint16 uiPresent;
+	uint16 uiRaw;
+	uint16 uiHeader;
+	int32 lValue;
+	uint32 ulZigZag;
+	uint16 uiSupply;
+
+	ucAllowDelta = (ucReqVersion >= SP_PACKEDDELTA_VERSION);
+
+	// Attach the supply so the CP can plan the heavy sweeps
+	uiSupply = uiPWR_GetSupply();
+	if (uiSupply)
+	{
+		S_Report[SUPPLY_GEN].m_ucaData[0] = (uint8) (uiSupply >> 8);
+		S_Report[SUPPLY_GEN].m_ucaData[1] = (uint8) uiSupply;
+		S_Report[SUPPLY_GEN].m_ucLength = 2;
+		S_Report[SUPPLY_GEN].m_ucFlags = F_NEWDATA;
+		S_Report[SUPPLY_GEN].m_ulTimestamp = ulMain_GetSeconds();
+	}
 
-	if (!cSTM_Initialized)
+	uiPresent = 0;
+	uiRaw = 0;
+	for (ucDataGenCnt = 0; ucDataGenCnt < NUMDATGEN; ucDataGenCnt++)
 	{
-		vSTM_Initialize();
-		cSTM_Initialized = 1;
+		if (S_Report[ucDataGenCnt].m_ucFlags & F_NEWDATA)
+			uiPresent |= (1 << ucDataGenCnt);
+		if (S_Report[ucDataGenCnt].m_ucFlags & F_RAWDATA)
+			uiRaw |= (1 << ucDataGenCnt);
 	}
+	uiRaw &= uiPresent;
 
-	cResult = cSTM_Measure(4);
+	// A delta needs a reference for every number in the report
+	if (uiPresent & ~uiRaw & ~g_uiMain_PackedRefMask)
+		ucAllowDelta = 0;
 
-	if (cResult == 0)
+	uiHeader = uiPresent;
+	if (ucAllowDelta)
+		uiHeader |= PACKED_DELTA;
+	if (uiRaw)
+		uiHeader |= PACKED_RAW;
+
+	*pucBuff++ = (uint8) uiHeader;
+	*pucBuff++ = (uint8) (uiHeader >> 8);
+	*pucBuff++ = ++g_ucMain_PackedSeq;
+	ucLength = 3;
+
+	if (uiRaw)
 	{
-		// Get the soil moisture and soil temperature readings
-		lSoil = lSTM_GetSoil();
-		iTemperature = iSTM_GetTemp();
+		*pucBuff++ = (uint8) uiRaw;
+		*pucBuff++ = (uint8) (uiRaw >> 8);
+		ucLength += 2;
+	}
 
-		// Start the report length at the maximum
-		S_Report[7].m_ucLength = 4;
+	for (ucDataGenCnt = 0; ucDataGenCnt < NUMDATGEN; ucDataGenCnt++)
+	{
+		if (!(uiPresent & (1 << ucDataGenCnt)))
+			continue;
 
-		// To avoid sending zeros at the high end of the ulSoil variable we check for the the first non-zero byte
-		if ((lSoil & 0xFF800000) == 0)
+		if (uiRaw & (1 << ucDataGenCnt))
 		{
-			S_Report[7].m_ucLength--;
-			if ((lSoil & 0x00FF8000) == 0)
-			{
-				S_Report[7].m_ucLength--;
-				if ((lSoil & 0x0000FF80) == 0)
-					S_Report[7].m_ucLength--;
-			}
+			*pucBuff++ = S_Report[ucDataGenCnt].m_ucLength;
+			for (ucByteCnt = 0; ucByteCnt < S_Report[ucDataGenCnt].m_ucLength; ucByteCnt++)
+				*pucBuff++ = S_Report[ucDataGenCnt].m_ucaData[ucByteCnt];
+
+			ucLength += (S_Report[ucDataGenCnt].m_ucLength + 1);
+			continue;
 		}
-		// Left shift the data over so that leading zeros are removed
-		lSoil = lSoil << (8 * (4-S_Report[7].m_ucLength));
 
-		S_Report[7].m_ucaData[0] = (uint8) (lSoil >> 24);
-		S_Report[7].m_ucaData[1] = (uint8) (lSoil >> 16);
-		S_Report[7].m_ucaData[2] = (uint8) (lSoil >> 8);
-		S_Report[7].m_ucaData[3] = (uint8) lSoil;
+		lValue = lMain_ReportValue(ucDataGenCnt);
+		if (g_uiMain_DDITempMask & (1 << ucDataGenCnt))
+			lValue = iSTM_DDITempToTenths((int16) lValue);
+		ulZigZag = (uint32) lValue;
+		if (ucAllowDelta)
+			ulZigZag -= (uint32) g_laMain_PackedRef[ucDataGenCnt];
+		g_laMain_PackedRef[ucDataGenCnt] = lValue;
 
-		S_Report[8].m_ucaData[0] = (uint8) (iTemperature >> 8);
-		S_Report[8].m_ucaData[1] = (uint8) iTemperature;
-		S_Report[8].m_ucLength = 2;
+		// Zig-zag so that small negative numbers stay short
+		ulZigZag = (ulZigZag << 1) ^ ((ulZigZag & 0x80000000) ? 0xFFFFFFFF : 0);
 
+		ucByteCnt = ucMain_PutVarint(pucBuff, ulZigZag);
+		pucBuff += ucByteCnt;
+		ucLength += ucByteCnt;
 	}
-	else if (cResult == 1)// Checksum fail
-	{
 
-		S_Report[7].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[7].m_ucLength = 1;
+	// Generators left out of a delta report keep their reference
+	if (ucAllowDelta)
+		g_uiMain_PackedRefMask = (g_uiMain_PackedRefMask | uiPresent) & ~uiRaw;
+	else
+		g_uiMain_PackedRefMask = uiPresent & ~uiRaw;
+
+	if (ucReqVersion < SP_PACKEDVWC_VERSION)
+		return ucLength;
 
-		S_Report[8].m_ucaData[0] = STM_ERROR_CODE_1;
-		S_Report[8].m_ucLength = 1;
+	// The water content of every 5TM and 5TE soil reading in the report, bit n = STM n + 1
+	ucVWCMask = 0;
+	for (ucTransNum = 1; ucTransNum <= NUM_TRANSDUCERS; ucTransNum++)
+	{
+		psTrans = &g_saMain_Transducers[ucTransNum];
+		if (psTrans->m_ucChannel && (g_uiMain_DDITempMask & (1 << psTrans->m_ucTempGen))
+				&& (uiPresent & ~uiRaw & (1 << psTrans->m_ucSoilGen)))
+			ucVWCMask |= (1 << (psTrans->m_ucChannel - 1));
 	}
-	else if (cResult == 2)//Timeout
+
+	*pucBuff++ = ucVWCMask;
+	ucLength++;
+
+	for (ucTransNum = 1; ucTransNum <= NUM_TRANSDUCERS; ucTransNum++)
 	{
-		S_Report[7].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[7].m_ucLength = 1;
+		psTrans = &g_saMain_Transducers[ucTransNum];
+		if (!psTrans->m_ucChannel || !(ucVWCMask & (1 << (psTrans->m_ucChannel - 1))))
+			continue;
 
-		S_Report[8].m_ucaData[0] = STM_ERROR_CODE_2;
-		S_Report[8].m_ucLength = 1;
+		ucByteCnt = ucMain_PutVarint(pucBuff, uiSTM_SoilToVWC(lMain_ReportValue(psTrans->m_ucSoilGen)));
+		pucBuff += ucByteCnt;
+		ucLength += ucByteCnt;
 	}
 
-	S_Report[7].m_ucFlags = F_NEWDATA;
-	S_Report[8].m_ucFlags = F_NEWDATA;
+	return ucLength;
+}
 
-	return 0;
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Fetches the requested transducer label and writes it to the passed array
+//!
+//!	\param ucTransNum, the desired transducer; *pucLabelArray, pointer to the label array
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+void vMain_FetchLabel(uint8 ucTransNum, volatile uint8 * pucLabelArray)
+{
+	uint8 ucLoopCount;
+	const char *pcLabel;
+
+	// For each transducer, use the table to get the label
+	if (ucTransNum <= NUM_TRANSDUCERS)
+		pcLabel = g_saMain_Transducers[ucTransNum].m_pcLabel;
+	else
+		pcLabel = "CANNOT COMPUTE!!";
+
+	for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
+		*pucLabelArray++ = pcLabel[ucLoopCount];
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Returns how long a measurement of a transducer takes
+//!
+//! An STM that has been measured reports its average time, see
+//! uiSTM_GetDurationMs(), anything else the time of the transducer table.
+//!
+//! \param ucTransNum, the transducer number, at most NUM_TRANSDUCERS
+//! \return The time in ms
+///////////////////////////////////////////////////////////////////////////////
+static uint16 uiMain_GetSampleDurationMs(uint8 ucTransNum)
+{
+	uint16 uiMs;
+
+	uiMs = uiSTM_GetDurationMs(g_saMain_Transducers[ucTransNum].m_ucChannel);
+	if (uiMs == 0)
+		uiMs = 1000 * g_saMain_Transducers[ucTransNum].m_ucSampleDuration;
+
+	return uiMs;
+}
 
+#if COMM_SEGMENTED_ENABLED
 ///////////////////////////////////////////////////////////////////////////////
 //!
-//! \brief Initializes the data storage structure
+//! \brief Writes the current sample durations into g_ucaMain_Describe
 //!
 //! \param none
 //! \return none
 ///////////////////////////////////////////////////////////////////////////////
-void vMain_CleanDataStruct(void)
+static void vMain_PutDescribeDurations(void)
 {
-	uint8 ucDataGenCnt;
-	uint8 ucByteCnt;
+	uint8 *pucEntry;
+	uint8 ucTransNum;
+	uint16 uiMs;
 
-	// Clean out the data storage structure
-	for (ucDataGenCnt = 0; ucDataGenCnt < NUMDATGEN; ucDataGenCnt++) {
-		S_Report[ucDataGenCnt].m_ucFlags = 0;
-		S_Report[ucDataGenCnt].m_ucLength = 0;
-
-		for (ucByteCnt = 0; ucByteCnt < MAXDATALEN; ucByteCnt++) {
-			S_Report[ucDataGenCnt].m_ucaData[ucByteCnt] = 0;
-		}
+	pucEntry = &g_ucaMain_Describe[1 + MAIN_DESCRIBE_MS_IDX];
+	for (ucTransNum = TRANSDUCER_1; ucTransNum <= NUM_TRANSDUCERS; ucTransNum++)
+	{
+		uiMs = uiMain_GetSampleDurationMs(ucTransNum);
+		pucEntry[0] = (uint8) uiMs;
+		pucEntry[1] = (uint8) (uiMs >> 8);
+		pucEntry += MAIN_DESCRIBE_ENTRY_LEN;
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //!
-//! \brief Loads the passed buffer with data stored in the S_Report structure
+//! \brief Builds g_ucaMain_Describe from the transducer table
 //!
-//! \param *pBuff
-//! \return ucLength, the amount of bytes added to the passed buffer
+//! \param none
+//! \return none
 ///////////////////////////////////////////////////////////////////////////////
-uint8 ucMain_FetchData(volatile uint8 * pucBuff)
+static void vMain_BuildDescribe(void)
 {
-	uint8 ucDataGenCnt;
-	uint8 ucByteCnt;
-	uint8 ucLength;
+	const S_Transducer *psTrans;
+	uint8 *pucOut;
+	uint8 ucTransNum;
+	uint8 ucIdx;
 
-	// Assume no data
-	ucLength = 0;
+	g_ucMain_DescribeGen = ucSTM_GetTypeGen();
 
-	// Check all the data generators for new data
-	for (ucDataGenCnt = 0; ucDataGenCnt < NUMDATGEN; ucDataGenCnt++)
+	pucOut = g_ucaMain_Describe;
+	*pucOut++ = NUM_TRANSDUCERS;
+
+	for (ucTransNum = TRANSDUCER_1; ucTransNum <= NUM_TRANSDUCERS; ucTransNum++)
 	{
-		// If there is new data to report then write to the passed buffer
-		if (S_Report[ucDataGenCnt].m_ucFlags & F_NEWDATA)
-		{
-			// write the data generator ID and the length of this message
-			*pucBuff++ = ucDataGenCnt;
-			*pucBuff++ = S_Report[ucDataGenCnt].m_ucLength;
+		psTrans = &g_saMain_Transducers[ucTransNum];
 
-			// write the data
-			for (ucByteCnt = 0; ucByteCnt < S_Report[ucDataGenCnt].m_ucLength; ucByteCnt++)
-			{
-				*pucBuff++ = S_Report[ucDataGenCnt].m_ucaData[ucByteCnt];
-			}
+		*pucOut++ = psTrans->m_ucType;
+		*pucOut++ = cSTM_ReturnSensorType(psTrans->m_ucChannel);
+		pucOut += 2;
 
-			// Update the length variable. Includes raw data, data generator ID, and length byte lengths
-			ucLength += (S_Report[ucDataGenCnt].m_ucLength + 2);
-		}
+		for (ucIdx = 0; ucIdx < TRANSDUCER_LABEL_LEN; ucIdx++)
+			*pucOut++ = psTrans->m_pcLabel[ucIdx];
 	}
 
-return ucLength;
+	vMain_PutDescribeDurations();
 }
 
-
 ///////////////////////////////////////////////////////////////////////////////
 //!
-//! \brief Fetches the requested transducer label and writes it to the passed array
+//! \brief Fills one frame of a segmented INTERROGATE or REQUEST_LABEL reply
 //!
-//!	\param ucTransNum, the desired transducer; *pucLabelArray, pointer to the label array
-//! \return none
+//! The cache is rebuilt at the start of a transfer if a sensor type changed
+//! since it was built, so every frame of a transfer comes from the same one.
+//! The sample durations follow every measurement and are updated each time.
+//!
+//! \param puiCursor, the offset into the cache, moved behind the frame
+//! \param pucBuff, the frame payload
+//! \param pucLast, set to 1 on the last frame
+//! \return The length of the payload
 ///////////////////////////////////////////////////////////////////////////////
-void vMain_FetchLabel(uint8 ucTransNum, volatile uint8 * pucLabelArray)
+uint8 ucMain_FetchDescribeFrame(uint16 *puiCursor, uint8 *pucBuff, uint8 *pucLast)
 {
-	uint8 ucLoopCount;
+	uint8 ucLength;
+	uint8 ucIdx;
 
-	switch (ucTransNum)
+	if (*puiCursor == 0)
 	{
-		// For each transducer, use the table to get the label
-		case TRANSDUCER_0:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = TRANSDUCER_0_LABEL_TXT[ucLoopCount];
-		break;
-		case TRANSDUCER_1:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = TRANSDUCER_1_LABEL_TXT[ucLoopCount];
-		break;
-
-		case TRANSDUCER_2:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = TRANSDUCER_2_LABEL_TXT[ucLoopCount];
-		break;
-
-		case TRANSDUCER_3:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = TRANSDUCER_3_LABEL_TXT[ucLoopCount];
-		break;
-
-		case TRANSDUCER_4:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = TRANSDUCER_4_LABEL_TXT[ucLoopCount];
-		break;
-		default:
-			for (ucLoopCount = 0x00; ucLoopCount < TRANSDUCER_LABEL_LEN; ucLoopCount++)
-				*pucLabelArray++ = "CANNOT COMPUTE!!"[ucLoopCount];
-		break;
-
-	} // END: switch(ucTransNum)
+		if (g_ucMain_DescribeGen != ucSTM_GetTypeGen())
+			vMain_BuildDescribe();
+		else
+			vMain_PutDescribeDurations();
+	}
+
+	ucLength = MSG_SEG_MAX_PAYLOAD;
+	if ((MAIN_DESCRIBE_LEN - *puiCursor) <= MSG_SEG_MAX_PAYLOAD)
+	{
+		ucLength = MAIN_DESCRIBE_LEN - *puiCursor;
+		*pucLast = 1;
+	}
+
+	for (ucIdx = 0; ucIdx < ucLength; ucIdx++)
+		pucBuff[ucIdx] = g_ucaMain_Describe[*puiCursor + ucIdx];
 
+	*puiCursor += ucLength;
+
+	return ucLength;
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 //!
@@ -625,35 +815,34 @@ uint8 ucMain_getNumTransducers(void)
 ///////////////////////////////////////////////////////////////////////////////
 uint8 ucMain_getTransducerType(uint8 ucTransNum)
 {
-	uint8 ucRetVal;
-
-	switch (ucTransNum)
-	{
-		case TRANSDUCER_1:
-		case TRANSDUCER_2:
-		case TRANSDUCER_3:
-		case TRANSDUCER_4:
-			ucRetVal = TYPE_IS_SENSOR; // For SP-STM board all the transducers are sensors
-		break;
-
-			// This is an error, we should not ever return 0
-		default:
-			ucRetVal = 0;
-		break;
-	}
+	// This is an error, we should not ever return 0
+	if ((ucTransNum == TRANSDUCER_0) || (ucTransNum > NUM_TRANSDUCERS))
+		return 0;
 
-	return ucRetVal;
+	return g_saMain_Transducers[ucTransNum].m_ucType;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 //!
 //! \brief Returns the sample duration required for a sensor
 //!
+//! The measured time is rounded up to whole seconds for the INTERROGATE
+//! reply, a segmented INTERROGATE has it in ms.
+//!
 //! \param ucTransNum, the transducer number
 ///////////////////////////////////////////////////////////////////////////////
 uint8 ucMain_getSampleDuration(uint8 ucTransNum)
 {
-	return 1;// For SP-STM board all the transducers use 1 second to sample
+	uint16 uiSeconds;
+
+	if (ucTransNum > NUM_TRANSDUCERS)
+		return 0;
+
+	uiSeconds = (uiMain_GetSampleDurationMs(ucTransNum) + 999) / 1000;
+	if (uiSeconds > 0xFF)
+		uiSeconds = 0xFF;
+
+	return (uint8) uiSeconds;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -664,6 +853,8 @@ uint8 ucMain_getSampleDuration(uint8 ucTransNum)
 //! to dispatch to the sensor functions decouples the core since it does not
 //! need to "know" anything about the number of transducers
 //!
+//! A burst in the parameters has already been applied by vMain_ApplyParams().
+//!
 //! \param ucCmdTransNum, the transducer number; ucCmdParamLen, length of parameters
 //! *ucParam, pointer to parameter array
 //! \return
@@ -671,60 +862,287 @@ uint8 ucMain_getSampleDuration(uint8 ucTransNum)
 ///////////////////////////////////////////////////////////////////////////////
 uint16 uiMainDispatch(uint8 ucCmdTransNum, uint8 ucCmdParamLen, uint8 *ucParam)
 {
-	uint8 ucRetVal;
-	
-	switch (ucCmdTransNum)
-	{
-		case 0:
-			ucRetVal = uiMain_Test(ucParam);
-		break;
+	const S_Transducer *psTrans;
+	uint16 uiResult;
 
-		case 1:
-			ucRetVal = uiMain_STM1(ucParam);
-		break;
+	if (ucCmdTransNum > NUM_TRANSDUCERS)
+		return 1;
 
-		case 2:
-			ucRetVal = uiMain_STM2(ucParam);
-		break;
+	psTrans = &g_saMain_Transducers[ucCmdTransNum];
 
-		case 3:
-			ucRetVal = uiMain_STM3(ucParam);
-		break;
+	uiResult = psTrans->m_pfnHandler(psTrans, ucParam);
 
-		case 4:
-			ucRetVal = uiMain_STM4(ucParam);
-		break;
+	return uiResult;
+}
 
-		default:
-			ucRetVal = 1;
-		break;
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Called by the core with the parameters of every transducer of a command
+//!
+//! Only for a COMMAND_PKT with CMD_BURST_BIT set.  This runs before
+//! vMain_PrepareDispatch(), so the parameters hold for the measurement of
+//! this command, batched or not.  The first parameter of an STM transducer
+//! is the number of frames per measurement, see ucSTM_SetBurst().
+//!
+//! \param ucCmdTransNum, the transducer number; ucCmdParamLen, length of parameters
+//! *ucParam, pointer to parameter array
+///////////////////////////////////////////////////////////////////////////////
+void vMain_ApplyParams(uint8 ucCmdTransNum, uint8 ucCmdParamLen, uint8 *ucParam)
+{
+	if ((ucCmdTransNum > NUM_TRANSDUCERS) || (ucCmdParamLen == 0))
+		return;
+
+	if (g_saMain_Transducers[ucCmdTransNum].m_ucChannel)
+		ucSTM_SetBurst(g_saMain_Transducers[ucCmdTransNum].m_ucChannel, ucParam[0]);
+}
 
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Called by the core with every transducer of a command before dispatch
+//!
+//! When more than one STM is requested they are all measured at once with
+//! vSTM_MeasureBatch().  uiMain_STM() then picks up the batched
+//! results through cSTM_Measure() instead of exciting each sensor in turn.
+//!
+//! \param uiTransducerMask, bit n is set if transducer n is in the command
+///////////////////////////////////////////////////////////////////////////////
+void vMain_PrepareDispatch(uint16 uiTransducerMask)
+{
+#if STM_BATCH_ENABLED
+	uint8 ucChannelMask;
+	uint8 ucTransNum;
+
+	// Collect the STM channels of the requested transducers
+	ucChannelMask = 0;
+	for (ucTransNum = 0; ucTransNum <= NUM_TRANSDUCERS; ucTransNum++)
+	{
+		if ((uiTransducerMask & (1 << ucTransNum)) && g_saMain_Transducers[ucTransNum].m_ucChannel)
+			ucChannelMask |= (1 << (g_saMain_Transducers[ucTransNum].m_ucChannel - 1));
 	}
 
-	return ucRetVal;
+	// A single channel gains nothing from batching
+	if ((ucChannelMask & (ucChannelMask - 1)) == 0)
+		return;
+
+	if (!cSTM_Initialized)
+	{
+		vSTM_Initialize();
+		cSTM_Initialized = 1;
+	}
+
+	vSTM_MeasureBatch(ucChannelMask);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Sets the background sampling interval of a transducer
+//!
+//! The intervals are kept in the config store so the sampling resumes after
+//! a reset.
+//!
+//! \param ucTransNum, the transducer number; uiSeconds, the interval, 0 = off
+//! \return 0 on success, 1 if the transducer can not be sampled
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucMain_SetSampleInterval(uint8 ucTransNum, uint16 uiSeconds)
+{
+	uint8 ucIdx;
+
+	if ((ucTransNum < TRANSDUCER_1) || (ucTransNum > TRANSDUCER_4))
+		return 1;
+
+	ucIdx = ucTransNum - TRANSDUCER_1;
+
+	g_uiaMain_SampleInterval[ucIdx] = uiSeconds;
+	ucConfig_Write(CONFIG_KEY_INTERVALS, g_uiaMain_SampleInterval, NUM_SAMPLED_TRANSDUCERS);
+
+	// The timer of the transducer, a pending expiry of the old interval is dropped
+	vSched_StartTimer(ucIdx, uiSeconds, SCHED_EVT_SAMPLE);
+
+	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-//! \brief The handler for event triggered functions
+//!
+//! \brief Restores the background sampling intervals after a reset
+//!
+//! \param none
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vMain_RestoreSampleIntervals(void)
+{
+	uint8 ucIdx;
+
+	g_ulMain_Seconds = 0;
+
+	for (ucIdx = 0; ucIdx < NUM_SAMPLED_TRANSDUCERS; ucIdx++)
+		g_uiaMain_SampleInterval[ucIdx] = 0;
+
+	ucConfig_Read(CONFIG_KEY_INTERVALS, g_uiaMain_SampleInterval, NUM_SAMPLED_TRANSDUCERS);
+
+	for (ucIdx = 0; ucIdx < NUM_SAMPLED_TRANSDUCERS; ucIdx++)
+		vSched_StartTimer(ucIdx, g_uiaMain_SampleInterval[ucIdx], SCHED_EVT_SAMPLE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Sets the soil moisture threshold of a transducer
+//!
+//! The thresholds are kept in the config store.  The side is found again
+//! with the next sample, so changing a threshold does not notify by itself.
+//!
+//! \param ucTransNum, the transducer number; iThreshold, the threshold
+//! uiHysteresis, the band on each side of it, MAIN_THRESHOLD_OFF = off
+//! \return 0 on success, 1 if the transducer has no soil moisture
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucMain_SetThreshold(uint8 ucTransNum, int16 iThreshold, uint16 uiHysteresis)
+{
+	uint8 ucIdx;
+
+	if ((ucTransNum < TRANSDUCER_1) || (ucTransNum > TRANSDUCER_4))
+		return 1;
+
+	ucIdx = ucTransNum - TRANSDUCER_1;
+
+	g_uiaMain_Threshold[2 * ucIdx] = (uint16) iThreshold;
+	g_uiaMain_Threshold[2 * ucIdx + 1] = uiHysteresis;
+	g_ucaMain_Side[ucIdx] = MAIN_SIDE_UNKNOWN;
+
+	ucConfig_Write(CONFIG_KEY_THRESHOLDS, g_uiaMain_Threshold, 2 * NUM_SAMPLED_TRANSDUCERS);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Restores the thresholds after a reset
+//!
+//! \param none
+//! \return none
+///////////////////////////////////////////////////////////////////////////////
+static void vMain_RestoreThresholds(void)
+{
+	uint8 ucIdx;
+
+	for (ucIdx = 0; ucIdx < 2 * NUM_SAMPLED_TRANSDUCERS; ucIdx++)
+		g_uiaMain_Threshold[ucIdx] = MAIN_THRESHOLD_OFF;
+
+	for (ucIdx = 0; ucIdx < NUM_SAMPLED_TRANSDUCERS; ucIdx++)
+		g_ucaMain_Side[ucIdx] = MAIN_SIDE_UNKNOWN;
+
+	ucConfig_Read(CONFIG_KEY_THRESHOLDS, g_uiaMain_Threshold, 2 * NUM_SAMPLED_TRANSDUCERS);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Checks the last sample of a transducer against its threshold
+//!
+//! Inside the band the side is kept, so a reading that wanders around the
+//! threshold notifies once.  The first sample after a reset or a new
+//! threshold only finds the side.
+//!
+//! \param ucTransNum, the transducer number, TRANSDUCER_1 to TRANSDUCER_4
+//! \return 1 if the sample crossed the threshold, 0 if not
+///////////////////////////////////////////////////////////////////////////////
+static uint8 ucMain_CheckThreshold(uint8 ucTransNum)
+{
+	const S_Transducer *psTrans;
+	int32 lValue;
+	int32 lThreshold;
+	uint16 uiHysteresis;
+	uint8 ucIdx;
+	uint8 ucSide;
+	uint8 ucOldSide;
+	uint8 ucSensorType;
+
+	ucIdx = ucTransNum - TRANSDUCER_1;
+	psTrans = &g_saMain_Transducers[ucTransNum];
+
+	uiHysteresis = g_uiaMain_Threshold[2 * ucIdx + 1];
+	if (uiHysteresis == MAIN_THRESHOLD_OFF)
+		return 0;
+
+	// An error code is no reading
+	if (S_Report[psTrans->m_ucSoilGen].m_ucFlags & F_RAWDATA)
+		return 0;
+
+	lValue = lMain_ReportValue(psTrans->m_ucSoilGen);
+
+	ucSensorType = cSTM_ReturnSensorType(psTrans->m_ucChannel);
+	if ((ucSensorType == FIVETM) || (ucSensorType == FIVETE))
+		lValue = uiSTM_SoilToVWC(lValue);
+	else if (lValue < -32768)
+		lValue = -32768;
+	else if (lValue > 32767)
+		lValue = 32767;
+
+	lThreshold = (int16) g_uiaMain_Threshold[2 * ucIdx];
+	if (lValue > (lThreshold + uiHysteresis))
+		ucSide = MAIN_SIDE_ABOVE;
+	else if (lValue < (lThreshold - uiHysteresis))
+		ucSide = MAIN_SIDE_BELOW;
+	else
+		return 0;
+
+	if (ucSide == g_ucaMain_Side[ucIdx])
+		return 0;
+
+	ucOldSide = g_ucaMain_Side[ucIdx];
+	g_ucaMain_Side[ucIdx] = ucSide;
+
+	return (ucOldSide != MAIN_SIDE_UNKNOWN);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The handler of SCHED_EVT_SAMPLE
 //!
 //! Most of the tasks performed by the SP boards are at the immediate request
-//! of the CP board, but this is not always true.  This functions exists to handle the
-//!	case that there is an event that triggers the SP to exit to core.  Therefore
-//! the SP is capable of handling complex tasks while awaiting commands from the CP
+//! of the CP board, but this is not always true.  Work that is not requested
+//! is posted to the scheduler and handled while awaiting commands from the CP.
+//!
+//! Background samples run through the same dispatch as a COMMAND_PKT so the
+//! results land in S_Report and are returned by the next REQUEST_DATA.  A
+//! sample that crosses its threshold has the report pushed to the CP instead.
 //!
 ///////////////////////////////////////////////////////////////////////////////
-void vMain_EventTrigger(void)
+static void vMain_SampleDue(void)
 {
+	uint16 uiTransducerMask;
+	uint8 ucTransNum;
+	uint8 ucNotify;
 
-//	// If the turn off the valve flag is true then dispatch to the function
-//	if (g_ucEventTrigger & some flag) {
-//
-//		// Clear the flag
-//		g_ucEventTrigger &= ~some flag;
-//
-//		// Pull the interrrupt line high to tell the CP that we have data
-//		P_INT_OUT |= INT_PIN;
-//	}
+	// Every transducer whose timer expired, the timers of the sampled transducers start at 0
+	uiTransducerMask = (uint16) ucSched_TakeExpired(SCHED_SAMPLE_TIMERS) << TRANSDUCER_1;
+
+	// Several due STMs are read in one batch
+	vMain_PrepareDispatch(uiTransducerMask);
+
+	ucNotify = 0;
+	for (ucTransNum = TRANSDUCER_1; ucTransNum <= TRANSDUCER_4; ucTransNum++) {
+		if (uiTransducerMask & (1 << ucTransNum)) {
+			uiMainDispatch(ucTransNum, 0, NULL);
+			ucNotify |= ucMain_CheckThreshold(ucTransNum);
+		}
+	}
+
+	// One report for every crossing of this tick
+	if (ucNotify)
+		vCORE_PostReport();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//!
+//! \brief Loads the passed buffer with the health of the transducers
+//!
+//! Called by the core for the REQUEST_DIAG reply, the layout is the one of
+//! ucSTM_FetchHealth().
+//!
+//! \param *pucBuff
+//! \return The amount of bytes added to the passed buffer
+///////////////////////////////////////////////////////////////////////////////
+uint8 ucMain_FetchHealth(uint8 *pucBuff)
+{
+	return ucSTM_FetchHealth(pucBuff);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -753,11 +1171,25 @@ void main(void)
 	// Initialize core
 	vCORE_Initilize();
 
+	// The sensor types found before the reset give the first reads the right deadlines
+	vSTM_LoadSensorTypes();
+
+#if COMM_SEGMENTED_ENABLED
+	// Node discovery is answered from RAM from now on
+	vMain_BuildDescribe();
+#endif
+
 	// Clean the data storage structure
 	vMain_CleanDataStruct();
 
-	// Clear the event trigger flags
-	g_ucEventTrigger = 0;
+	// Background samples are posted by the scheduler timers
+	vSched_SetHandler(SCHED_EVT_SAMPLE, vMain_SampleDue);
+
+	// Resume the background sampling the CP set up before the reset
+	vMain_RestoreSampleIntervals();
+
+	// And the thresholds it is notified on
+	vMain_RestoreThresholds();
 
 	//Run core
 	vCORE_Run();